@@ -1,7 +1,18 @@
 #include "Chip8.h"
-#include <fstream>
-#include <iostream>
+#include "Chip8Debugger.h"
+#include "Chip8Expand.h"
+#include "Chip8Profile.h"
+#include "Chip8SaveState.h"
+#include "Chip8Timing.h"
+#include "Chip8Trace.h"
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // CHIP-8 fontset (each character is 4x5 pixels)
 uint8_t fontset[80] = {
@@ -23,390 +34,957 @@ uint8_t fontset[80] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-Chip8::Chip8() : gen(rd()), dis(0, 255), debugMode(false) {
+Chip8::Chip8() : state(&localState), randomSource(nullptr), profile(nullptr), trace(nullptr), decodedCount(-1),
+      codeObserver(nullptr), skippedCycles(0) {
+    quirks = Chip8Quirks::Profile::Default;
+    useQuirks<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>();
     initialize();
 }
 
-void Chip8::initialize() {
-    pc = 0x200;         // Program counter starts at 0x200
-    I = 0;              // Reset index register
-    sp = 0;             // Reset stack pointer
-    
-    // Clear display
-    memset(gfx, 0, sizeof(gfx));
-    memset(display, 0, sizeof(display));
-    
-    // Clear stack
-    memset(stack, 0, sizeof(stack));
-    
-    // Clear registers V0-VF
-    memset(V, 0, sizeof(V));
-    
-    // Clear memory
-    memset(memory, 0, sizeof(memory));
-    
-    // Clear keys
-    memset(key, 0, sizeof(key));
-    
+Chip8::Chip8(Chip8State& state) : state(&state), randomSource(nullptr), profile(nullptr), trace(nullptr), decodedCount(-1),
+      codeObserver(nullptr), skippedCycles(0) {
+    quirks = Chip8Quirks::Profile::Default;
+    useQuirks<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>();
+    resetHost();
+}
+
+void Chip8::attach(Chip8State& newState) {
+    state = &newState;
+    resetHost();
+    drawFlag = true; // The whole screen is new to the frontend
+}
+
+void Chip8::resetState(Chip8State& state) {
+    memset(&state, 0, sizeof(state));
+    state.pc = 0x200;   // Program counter starts at 0x200
+    state.cyclesPerTick = 10;
+    state.rng.reseed(0);
+
     // Load fontset
-    loadFontset();
-    
-    // Reset timers
-    delay_timer = 0;
-    sound_timer = 0;
-    
-    // Reset flags
-    drawFlag = false;
-    soundFlag = false;
+    memcpy(state.memory, fontset, sizeof(fontset));
 }
 
-void Chip8::loadFontset() {
-    for (int i = 0; i < 80; ++i) {
-        memory[i] = fontset[i];
+void Chip8::snapshot(Chip8State& out) const {
+    memcpy(&out, state, sizeof(Chip8State));
+}
+
+void Chip8::restore(const Chip8State& snapshot) {
+    if (&snapshot == state)
+        return;
+
+    // Find what differs before overwriting it: 64-byte memory blocks for
+    // the decode cache, rows for the display
+    uint64_t blocks = 0;
+    for (int block = 0; block < 64; ++block) {
+        if (memcmp(state->memory + block * 64, snapshot.memory + block * 64, 64) != 0)
+            blocks |= 1ull << block;
+    }
+    uint32_t rows = 0;
+    for (int row = 0; row < 32; ++row) {
+        if (state->gfx[row] != snapshot.gfx[row])
+            rows |= 1u << row;
+    }
+
+    memcpy(state, &snapshot, sizeof(Chip8State));
+
+    for (int block = 0; blocks != 0; ++block, blocks >>= 1) {
+        if (blocks & 1)
+            invalidateCode(static_cast<uint16_t>(block * 64), 64);
     }
+    staleRows |= rows;
+    dirtyRows |= rows;
+    if (rows)
+        drawFlag = true;
+    events = 0;
+    idleCheck = false;
+    faultHalt = false;
+}
+
+std::vector<uint8_t> Chip8::saveState() const {
+    return Chip8SaveState::serialize(*state);
+}
+
+bool Chip8::loadState(const uint8_t* data, size_t size) {
+    Chip8State loaded;
+    if (!Chip8SaveState::deserialize(data, size, loaded))
+        return false;
+    restore(loaded);
+    return true;
+}
+
+void Chip8::initialize() {
+    resetState(*state);
+    resetHost();
+}
+
+void Chip8::resetHost() {
+    // Everything derived from the attached state is rebuilt on demand
+    staleRows = ~0u;
+    dirtyRows = ~0u;
+    invalidateAllCode();
+
+    // Reset flags
+    drawFlag = false;
+    soundFlag = false;
+    events = 0;
+    idleCheck = false;
+    faultHalt = false;
 }
 
-void Chip8::loadRom(const char* filename) {
+bool Chip8::loadRom(const char* filename) {
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     
     if (!file.is_open()) {
-        std::cerr << "Error: Could not open ROM file " << filename << std::endl;
-        return;
+        fprintf(stderr, "Error: Could not open ROM file %s\n", filename);
+        return false;
     }
     
     std::streamsize size = file.tellg();
     file.seekg(0, std::ios::beg);
     
-    if (size <= (4096 - 512)) {
-        file.read(reinterpret_cast<char*>(memory + 512), size);
-        std::cout << "ROM loaded successfully: " << filename << " (" << size << " bytes)" << std::endl;
-    } else {
-        std::cerr << "Error: ROM too large for memory" << std::endl;
+    if (size > (4096 - 512)) {
+        fprintf(stderr, "Error: ROM too large for memory\n");
+        return false;
     }
-    
-    file.close();
+
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+    loadRom(data.data(), data.size());
+    printf("ROM loaded successfully: %s (%d bytes)\n", filename, static_cast<int>(size));
+    return true;
 }
 
-void Chip8::cycle() {
-    // Fetch opcode
-    uint16_t opcode = memory[pc] << 8 | memory[pc + 1];
-    
-    if (debugMode) {
-        std::cout << "PC: 0x" << std::hex << pc << " Opcode: 0x" << opcode << std::dec << std::endl;
+bool Chip8::loadRom(const uint8_t* data, size_t size) {
+    if (size > 4096 - 512)
+        return false;
+    memcpy(state->memory + 512, data, size);
+    invalidateCode(512, static_cast<int>(size));
+    return true;
+}
+
+// Opcode patterns and the decode table generated from them at compile time.
+// The table is indexed by the first and last two nibbles of an opcode (the X
+// nibble never selects an instruction), so it stays 4 KB and cache friendly.
+// It maps an opcode to a slot; every quirk profile has its own handler per
+// slot, taken from its instantiation of the pattern list.
+struct Chip8::Dispatch {
+    struct Pattern {
+        uint16_t mask;
+        uint16_t value;
+        OpHandler handler;
+        const char* name;
+    };
+
+    template<typename Quirks>
+    static constexpr Pattern patterns[] = {
+        { 0x0000, 0x0000, &Chip8::opUnknown, "unknown" },  // Slot 0: no pattern matched
+        { 0xF00F, 0x0000, &Chip8::op00E0, "00E0" },
+        { 0xF00F, 0x000E, &Chip8::op00EE, "00EE" },
+        { 0xF000, 0x1000, &Chip8::op1NNN, "1NNN" },
+        { 0xF000, 0x2000, &Chip8::op2NNN, "2NNN" },
+        { 0xF000, 0x3000, &Chip8::op3XNN, "3XNN" },
+        { 0xF000, 0x4000, &Chip8::op4XNN, "4XNN" },
+        { 0xF000, 0x5000, &Chip8::op5XY0, "5XY0" },
+        { 0xF000, 0x6000, &Chip8::op6XNN, "6XNN" },
+        { 0xF000, 0x7000, &Chip8::op7XNN, "7XNN" },
+        { 0xF00F, 0x8000, &Chip8::op8XY0, "8XY0" },
+        { 0xF00F, 0x8001, &Chip8::op8XY1<Quirks>, "8XY1" },
+        { 0xF00F, 0x8002, &Chip8::op8XY2<Quirks>, "8XY2" },
+        { 0xF00F, 0x8003, &Chip8::op8XY3<Quirks>, "8XY3" },
+        { 0xF00F, 0x8004, &Chip8::op8XY4, "8XY4" },
+        { 0xF00F, 0x8005, &Chip8::op8XY5, "8XY5" },
+        { 0xF00F, 0x8006, &Chip8::op8XY6<Quirks>, "8XY6" },
+        { 0xF00F, 0x8007, &Chip8::op8XY7, "8XY7" },
+        { 0xF00F, 0x800E, &Chip8::op8XYE<Quirks>, "8XYE" },
+        { 0xF000, 0x9000, &Chip8::op9XY0, "9XY0" },
+        { 0xF000, 0xA000, &Chip8::opANNN, "ANNN" },
+        { 0xF000, 0xB000, &Chip8::opBNNN<Quirks>, "BNNN" },
+        { 0xF000, 0xC000, &Chip8::opCXNN, "CXNN" },
+        { 0xF000, 0xD000, &Chip8::opDXYN<Quirks>, "DXYN" },
+        { 0xF0FF, 0xE09E, &Chip8::opEX9E, "EX9E" },
+        { 0xF0FF, 0xE0A1, &Chip8::opEXA1, "EXA1" },
+        { 0xF0FF, 0xF007, &Chip8::opFX07, "FX07" },
+        { 0xF0FF, 0xF00A, &Chip8::opFX0A, "FX0A" },
+        { 0xF0FF, 0xF015, &Chip8::opFX15, "FX15" },
+        { 0xF0FF, 0xF018, &Chip8::opFX18, "FX18" },
+        { 0xF0FF, 0xF01E, &Chip8::opFX1E, "FX1E" },
+        { 0xF0FF, 0xF029, &Chip8::opFX29, "FX29" },
+        { 0xF0FF, 0xF033, &Chip8::opFX33, "FX33" },
+        { 0xF0FF, 0xF055, &Chip8::opFX55<Quirks>, "FX55" },
+        { 0xF0FF, 0xF065, &Chip8::opFX65<Quirks>, "FX65" },
+    };
+    // Masks and names are the same in every profile
+    using Reference = Chip8Quirks::Set<Chip8Quirks::Profile::Default>;
+    static constexpr int patternCount = sizeof(patterns<Reference>) / sizeof(Pattern);
+
+    static constexpr int key(uint16_t opcode) {
+        return ((opcode >> 4) & 0xF00) | (opcode & 0x0FF);
     }
-    
-    // Decode and execute
-    switch (opcode & 0xF000) {
-        case 0x0000:
-            switch (opcode & 0x000F) {
-                case 0x0000: // 0x00E0: Clear display
-                    memset(gfx, 0, sizeof(gfx));
-                    memset(display, 0, sizeof(display));
-                    drawFlag = true;
-                    pc += 2;
-                    break;
-                    
-                case 0x000E: // 0x00EE: Return from subroutine
-                    --sp;
-                    pc = stack[sp];
-                    pc += 2;
+
+    struct Table {
+        uint8_t slot[4096];
+    };
+
+    static constexpr Table buildTable() {
+        Table table{};
+        for (int k = 0; k < 4096; ++k) {
+            uint16_t opcode = static_cast<uint16_t>(((k & 0xF00) << 4) | (k & 0x0FF));
+            for (int p = 1; p < patternCount; ++p) {
+                if ((opcode & patterns<Reference>[p].mask) == patterns<Reference>[p].value) {
+                    table.slot[k] = static_cast<uint8_t>(p);
                     break;
-                    
-                default:
-                    std::cerr << "Unknown opcode: 0x" << std::hex << opcode << std::endl;
-                    pc += 2;
+                }
             }
-            break;
-            
-        case 0x1000: // 0x1NNN: Jump to address NNN
-            pc = opcode & 0x0FFF;
-            break;
-            
-        case 0x2000: // 0x2NNN: Call subroutine at NNN
-            stack[sp] = pc;
-            ++sp;
-            pc = opcode & 0x0FFF;
-            break;
-            
-        case 0x3000: // 0x3XNN: Skip next instruction if VX equals NN
-            if (V[(opcode & 0x0F00) >> 8] == (opcode & 0x00FF))
-                pc += 4;
-            else
-                pc += 2;
-            break;
-            
-        case 0x4000: // 0x4XNN: Skip next instruction if VX doesn't equal NN
-            if (V[(opcode & 0x0F00) >> 8] != (opcode & 0x00FF))
-                pc += 4;
-            else
-                pc += 2;
-            break;
-            
-        case 0x5000: // 0x5XY0: Skip next instruction if VX equals VY
-            if (V[(opcode & 0x0F00) >> 8] == V[(opcode & 0x00F0) >> 4])
-                pc += 4;
-            else
-                pc += 2;
-            break;
-            
-        case 0x6000: // 0x6XNN: Set VX to NN
-            V[(opcode & 0x0F00) >> 8] = opcode & 0x00FF;
-            pc += 2;
-            break;
-            
-        case 0x7000: // 0x7XNN: Add NN to VX
-            V[(opcode & 0x0F00) >> 8] += opcode & 0x00FF;
-            pc += 2;
-            break;
-            
-        case 0x8000:
-            switch (opcode & 0x000F) {
-                case 0x0000: // 0x8XY0: Set VX to the value of VY
-                    V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4];
-                    pc += 2;
-                    break;
-                    
-                case 0x0001: // 0x8XY1: Set VX to VX or VY
-                    V[(opcode & 0x0F00) >> 8] |= V[(opcode & 0x00F0) >> 4];
-                    pc += 2;
-                    break;
-                    
-                case 0x0002: // 0x8XY2: Set VX to VX and VY
-                    V[(opcode & 0x0F00) >> 8] &= V[(opcode & 0x00F0) >> 4];
-                    pc += 2;
-                    break;
-                    
-                case 0x0003: // 0x8XY3: Set VX to VX xor VY
-                    V[(opcode & 0x0F00) >> 8] ^= V[(opcode & 0x00F0) >> 4];
-                    pc += 2;
-                    break;
-                    
-                case 0x0004: // 0x8XY4: Add VY to VX, VF = carry
-                    {
-                        uint8_t x = (opcode & 0x0F00) >> 8;
-                        uint8_t y = (opcode & 0x00F0) >> 4;
-                        uint16_t sum = V[x] + V[y];
-                        V[0xF] = (sum > 255) ? 1 : 0;
-                        V[x] = sum & 0xFF;
-                    }
-                    pc += 2;
-                    break;
-                    
-                case 0x0005: // 0x8XY5: Subtract VY from VX, VF = NOT borrow
-                    {
-                        uint8_t x = (opcode & 0x0F00) >> 8;
-                        uint8_t y = (opcode & 0x00F0) >> 4;
-                        V[0xF] = (V[x] > V[y]) ? 1 : 0;
-                        V[x] -= V[y];
-                    }
-                    pc += 2;
-                    break;
-                    
-                case 0x0006: // 0x8XY6: Shift VX right by one, VF = LSB
-                    {
-                        uint8_t x = (opcode & 0x0F00) >> 8;
-                        V[0xF] = V[x] & 0x1;
-                        V[x] >>= 1;
-                    }
-                    pc += 2;
-                    break;
-                    
-                case 0x0007: // 0x8XY7: Set VX to VY minus VX, VF = NOT borrow
-                    {
-                        uint8_t x = (opcode & 0x0F00) >> 8;
-                        uint8_t y = (opcode & 0x00F0) >> 4;
-                        V[0xF] = (V[y] > V[x]) ? 1 : 0;
-                        V[x] = V[y] - V[x];
-                    }
-                    pc += 2;
-                    break;
-                    
-                case 0x000E: // 0x8XYE: Shift VX left by one, VF = MSB
-                    {
-                        uint8_t x = (opcode & 0x0F00) >> 8;
-                        V[0xF] = V[x] >> 7;
-                        V[x] <<= 1;
-                    }
-                    pc += 2;
-                    break;
-                    
-                default:
-                    std::cerr << "Unknown opcode: 0x" << std::hex << opcode << std::endl;
-                    pc += 2;
+        }
+        return table;
+    }
+
+    static constexpr bool patternsFitKey() {
+        for (int p = 0; p < patternCount; ++p) {
+            if (patterns<Reference>[p].mask & 0x0F00)
+                return false;
+        }
+        return true;
+    }
+
+    static const Table table;
+
+    struct Handlers {
+        OpHandler slot[patternCount];
+    };
+
+    template<typename Quirks>
+    static constexpr Handlers buildHandlers() {
+        Handlers handlers{};
+        for (int p = 0; p < patternCount; ++p)
+            handlers.slot[p] = patterns<Quirks>[p].handler;
+        return handlers;
+    }
+
+    template<typename Quirks>
+    static constexpr Handlers handlers = buildHandlers<Quirks>();
+
+    static int slot(uint16_t opcode) {
+        static_assert(patternsFitKey(), "Opcode patterns may not match on the X nibble");
+        return table.slot[key(opcode)];
+    }
+};
+
+constexpr Chip8::Dispatch::Table Chip8::Dispatch::table = Chip8::Dispatch::buildTable();
+
+int Chip8::opcodeFamily(uint16_t opcode) {
+    static_assert(Dispatch::patternCount == opcodeFamilyCount, "opcodeFamilyCount is out of date");
+    return Dispatch::slot(opcode);
+}
+
+const char* Chip8::opcodeFamilyName(int family) {
+    return family >= 0 && family < Dispatch::patternCount ? Dispatch::patterns<Dispatch::Reference>[family].name : "unknown";
+}
+
+Chip8::Instruction Chip8::decode(uint16_t opcode) {
+    Instruction in;
+    in.opcode = opcode;
+    in.nnn = opcode & 0x0FFF;
+    in.x = (opcode & 0x0F00) >> 8;
+    in.y = (opcode & 0x00F0) >> 4;
+    in.n = opcode & 0x000F;
+    in.nn = opcode & 0x00FF;
+    return in;
+}
+
+template<typename Quirks>
+void Chip8::useQuirks() {
+    handlers = Dispatch::handlers<Quirks>.slot;
+    executeSwitch = &Chip8::executeAs<Quirks>;
+}
+
+void Chip8::setQuirks(Chip8Quirks::Profile profile) {
+    using Profile = Chip8Quirks::Profile;
+    switch (profile) {
+        case Profile::Default:   useQuirks<Chip8Quirks::Set<Profile::Default>>(); break;
+        case Profile::VIP:       useQuirks<Chip8Quirks::Set<Profile::VIP>>(); break;
+        case Profile::CHIP48:    useQuirks<Chip8Quirks::Set<Profile::CHIP48>>(); break;
+        case Profile::SuperChip: useQuirks<Chip8Quirks::Set<Profile::SuperChip>>(); break;
+        case Profile::XOChip:    useQuirks<Chip8Quirks::Set<Profile::XOChip>>(); break;
+        default:                 return;
+    }
+    quirks = profile;
+    invalidateAllCode();
+}
+
+Chip8::OpHandler Chip8::lookupHandler(uint16_t opcode) const {
+    return handlers[Dispatch::slot(opcode)];
+}
+
+void Chip8::execute(const Instruction& in) {
+#ifndef CHIP8_SWITCH_DISPATCH
+    lookupHandler(in.opcode)(*this, in);
+#else
+    (this->*executeSwitch)(in);
+#endif
+}
+
+template<typename Quirks>
+void Chip8::executeAs(const Instruction& in) {
+    switch (in.opcode & 0xF000) {
+        case 0x0000:
+            switch (in.n) {
+                case 0x0: op00E0(*this, in); break;
+                case 0xE: op00EE(*this, in); break;
+                default:  opUnknown(*this, in);
             }
             break;
-            
-        case 0x9000: // 0x9XY0: Skip next instruction if VX doesn't equal VY
-            if (V[(opcode & 0x0F00) >> 8] != V[(opcode & 0x00F0) >> 4])
-                pc += 4;
-            else
-                pc += 2;
-            break;
-            
-        case 0xA000: // 0xANNN: Set I to the address NNN
-            I = opcode & 0x0FFF;
-            pc += 2;
-            break;
-            
-        case 0xB000: // 0xBNNN: Jump to the address NNN plus V0
-            pc = (opcode & 0x0FFF) + V[0];
-            break;
-            
-        case 0xC000: // 0xCXNN: Set VX to a random number masked by NN
-            V[(opcode & 0x0F00) >> 8] = getRandom() & (opcode & 0x00FF);
-            pc += 2;
-            break;
-            
-        case 0xD000: // 0xDXYN: Draw sprite at (VX, VY) with N bytes of sprite data starting at I
-            {
-                uint8_t x = V[(opcode & 0x0F00) >> 8];
-                uint8_t y = V[(opcode & 0x00F0) >> 4];
-                uint8_t height = opcode & 0x000F;
-                uint8_t pixel;
-                
-                V[0xF] = 0;
-                for (int yline = 0; yline < height; yline++) {
-                    pixel = memory[I + yline];
-                    for (int xline = 0; xline < 8; xline++) {
-                        if ((pixel & (0x80 >> xline)) != 0) {
-                            int px = (x + xline) % 64;
-                            int py = (y + yline) % 32;
-                            if (gfx[px + py * 64] == 1)
-                                V[0xF] = 1;
-                            gfx[px + py * 64] ^= 1;
-                        }
-                    }
-                }
-                
-                // Update display buffer
-                for (int i = 0; i < 64 * 32; ++i) {
-                    display[i] = gfx[i] ? 0xFFFFFFFF : 0x00000000;
-                }
-                
-                drawFlag = true;
-                pc += 2;
+        case 0x1000: op1NNN(*this, in); break;
+        case 0x2000: op2NNN(*this, in); break;
+        case 0x3000: op3XNN(*this, in); break;
+        case 0x4000: op4XNN(*this, in); break;
+        case 0x5000: op5XY0(*this, in); break;
+        case 0x6000: op6XNN(*this, in); break;
+        case 0x7000: op7XNN(*this, in); break;
+        case 0x8000:
+            switch (in.n) {
+                case 0x0: op8XY0(*this, in); break;
+                case 0x1: op8XY1<Quirks>(*this, in); break;
+                case 0x2: op8XY2<Quirks>(*this, in); break;
+                case 0x3: op8XY3<Quirks>(*this, in); break;
+                case 0x4: op8XY4(*this, in); break;
+                case 0x5: op8XY5(*this, in); break;
+                case 0x6: op8XY6<Quirks>(*this, in); break;
+                case 0x7: op8XY7(*this, in); break;
+                case 0xE: op8XYE<Quirks>(*this, in); break;
+                default:  opUnknown(*this, in);
             }
             break;
-            
+        case 0x9000: op9XY0(*this, in); break;
+        case 0xA000: opANNN(*this, in); break;
+        case 0xB000: opBNNN<Quirks>(*this, in); break;
+        case 0xC000: opCXNN(*this, in); break;
+        case 0xD000: opDXYN<Quirks>(*this, in); break;
         case 0xE000:
-            switch (opcode & 0x00FF) {
-                case 0x009E: // 0xEX9E: Skip next instruction if key stored in VX is pressed
-                    if (key[V[(opcode & 0x0F00) >> 8]] != 0)
-                        pc += 4;
-                    else
-                        pc += 2;
-                    break;
-                    
-                case 0x00A1: // 0xEXA1: Skip next instruction if key stored in VX isn't pressed
-                    if (key[V[(opcode & 0x0F00) >> 8]] == 0)
-                        pc += 4;
-                    else
-                        pc += 2;
-                    break;
-                    
-                default:
-                    std::cerr << "Unknown opcode: 0x" << std::hex << opcode << std::endl;
-                    pc += 2;
+            switch (in.nn) {
+                case 0x9E: opEX9E(*this, in); break;
+                case 0xA1: opEXA1(*this, in); break;
+                default:   opUnknown(*this, in);
             }
             break;
-            
         case 0xF000:
-            switch (opcode & 0x00FF) {
-                case 0x0007: // 0xFX07: Set VX to the value of the delay timer
-                    V[(opcode & 0x0F00) >> 8] = delay_timer;
-                    pc += 2;
-                    break;
-                    
-                case 0x000A: // 0xFX0A: Wait for a key press, store the value of the key in VX
-                    {
-                        bool keyPressed = false;
-                        for (int i = 0; i < 16; ++i) {
-                            if (key[i] != 0) {
-                                V[(opcode & 0x0F00) >> 8] = i;
-                                keyPressed = true;
-                                break;
-                            }
-                        }
-                        if (!keyPressed)
-                            return; // Don't increment pc, wait for key press
-                        pc += 2;
-                    }
-                    break;
-                    
-                case 0x0015: // 0xFX15: Set the delay timer to VX
-                    delay_timer = V[(opcode & 0x0F00) >> 8];
-                    pc += 2;
-                    break;
-                    
-                case 0x0018: // 0xFX18: Set the sound timer to VX
-                    sound_timer = V[(opcode & 0x0F00) >> 8];
-                    pc += 2;
-                    break;
-                    
-                case 0x001E: // 0xFX1E: Add VX to I
-                    I += V[(opcode & 0x0F00) >> 8];
-                    pc += 2;
-                    break;
-                    
-                case 0x0029: // 0xFX29: Set I to the location of the sprite for character in VX
-                    I = V[(opcode & 0x0F00) >> 8] * 0x5;
-                    pc += 2;
-                    break;
-                    
-                case 0x0033: // 0xFX33: Store binary-coded decimal representation of VX at I, I+1, I+2
-                    {
-                        uint8_t value = V[(opcode & 0x0F00) >> 8];
-                        memory[I] = value / 100;
-                        memory[I + 1] = (value / 10) % 10;
-                        memory[I + 2] = (value % 100) % 10;
-                    }
-                    pc += 2;
-                    break;
-                    
-                case 0x0055: // 0xFX55: Store registers V0 through VX in memory starting at location I
-                    for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i)
-                        memory[I + i] = V[i];
-                    pc += 2;
-                    break;
-                    
-                case 0x0065: // 0xFX65: Read registers V0 through VX from memory starting at location I
-                    for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i)
-                        V[i] = memory[I + i];
-                    pc += 2;
-                    break;
-                    
-                default:
-                    std::cerr << "Unknown opcode: 0x" << std::hex << opcode << std::endl;
-                    pc += 2;
+            switch (in.nn) {
+                case 0x07: opFX07(*this, in); break;
+                case 0x0A: opFX0A(*this, in); break;
+                case 0x15: opFX15(*this, in); break;
+                case 0x18: opFX18(*this, in); break;
+                case 0x1E: opFX1E(*this, in); break;
+                case 0x29: opFX29(*this, in); break;
+                case 0x33: opFX33(*this, in); break;
+                case 0x55: opFX55<Quirks>(*this, in); break;
+                case 0x65: opFX65<Quirks>(*this, in); break;
+                default:   opUnknown(*this, in);
             }
             break;
-            
-        default:
-            std::cerr << "Unknown opcode: 0x" << std::hex << opcode << std::endl;
-            pc += 2;
     }
-    
-    // Update timers
-    if (delay_timer > 0)
-        --delay_timer;
-        
-    if (sound_timer > 0) {
-        if (sound_timer == 1)
-            soundFlag = true;
-        --sound_timer;
+}
+
+void Chip8::invalidateCode(uint16_t address, int length) {
+    // A write to byte N stales the cache entry for the word at N & ~1
+    for (int i = 0; i < length; ++i)
+        decodeCache[((address + i) & 0x0FFF) >> 1].handler = &Chip8::opDecode;
+    if (!codeObserver)
+        return;
+
+    // I can hold any 16-bit value and memory wraps at 4 KB, so hand the
+    // observer the range as one or two pieces inside memory
+    address &= 0x0FFF;
+    length = std::min(length, 4096);
+    int head = std::min(length, 4096 - address);
+    codeObserver->codeWritten(address, head);
+    if (head < length)
+        codeObserver->codeWritten(0, length - head);
+}
+
+void Chip8::invalidateAllCode() {
+    if (decodedCount < 0) {
+        for (CacheEntry& entry : decodeCache)
+            entry.handler = &Chip8::opDecode;
+    } else {
+        for (int i = 0; i < decodedCount; ++i)
+            decodeCache[decodedEntries[i]].handler = &Chip8::opDecode;
+    }
+    decodedCount = 0;
+    if (codeObserver)
+        codeObserver->codeReset();
+}
+
+void Chip8::opDecode(Chip8& c, const Instruction&) {
+    uint16_t address = c.state->pc & 0x0FFF;
+    CacheEntry& entry = c.decodeCache[address >> 1];
+    entry.in = decode(c.state->memory[address] << 8 | c.state->memory[address + 1]);
+    entry.handler = c.lookupHandler(entry.in.opcode);
+    // A rewritten entry is listed again, so the list can fill up
+    if (c.decodedCount >= 0 && c.decodedCount < 4096 / 2)
+        c.decodedEntries[c.decodedCount++] = address >> 1;
+    else
+        c.decodedCount = -1;
+    entry.handler(c, entry.in);
+}
+
+inline void Chip8::dispatch() {
+#ifndef CHIP8_SWITCH_DISPATCH
+    if ((state->pc & 1) == 0) {
+        // Cached path: even addresses are predecoded
+        const CacheEntry& entry = decodeCache[(state->pc & 0x0FFF) >> 1];
+        entry.handler(*this, entry.in);
+    } else {
+        uint16_t address = state->pc & 0x0FFF;
+        execute(decode(state->memory[address] << 8 | state->memory[(address + 1) & 0x0FFF]));
+    }
+#else
+    // Fetch, decode and execute
+    execute(decode(state->memory[state->pc & 0x0FFF] << 8 | state->memory[(state->pc + 1) & 0x0FFF]));
+#endif
+}
+
+#ifdef CHIP8_PROFILE
+// Count the instruction at pc and, if it is due for a timing sample,
+// execute it under the clock. Returns whether it was executed.
+bool Chip8::profileStep() {
+    uint16_t address = state->pc & 0x0FFF;
+    uint16_t opcode = state->memory[address] << 8 | state->memory[(address + 1) & 0x0FFF];
+    if (!profile->count(address, opcode))
+        return false;
+
+    Chip8Profile::Clock::time_point start = Chip8Profile::Clock::now();
+    dispatch();
+    profile->addSample(opcode, Chip8Profile::Clock::now() - start);
+    return true;
+}
+#endif
+
+inline void Chip8::executeNext() {
+#ifdef CHIP8_PROFILE
+    if (profile && profileStep())
+        return;
+#endif
+    dispatch();
+}
+
+// Bit n set where a[n] != b[n]
+static uint16_t changedRegisters(const uint8_t* a, const uint8_t* b) {
+#ifdef __SSE2__
+    __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    return static_cast<uint16_t>(~_mm_movemask_epi8(equal));
+#else
+    uint16_t changed = 0;
+    for (int i = 0; i < 16; ++i)
+        changed |= static_cast<uint16_t>(a[i] != b[i]) << i;
+    return changed;
+#endif
+}
+
+namespace {
+    // Tracing as a hooks policy wrapped around the caller's: each record is
+    // opened before the instruction and completed after it. Runs pick it
+    // once per call, so an untraced run loop contains no trace code.
+    template<typename Inner>
+    class TraceHooks {
+    public:
+        static constexpr bool enabled = true;
+
+        TraceHooks(Chip8Trace& trace, Inner& inner) : trace(trace), inner(inner), record(nullptr) {}
+
+        bool before(Chip8& chip8) {
+            if constexpr (Inner::enabled) {
+                if (!inner.before(chip8))
+                    return false;
+            }
+            const Chip8State& state = chip8.getState();
+            uint16_t address = state.pc & 0x0FFF;
+            record = &trace.append();
+            record->cycle = state.cycleCount;
+            record->pc = state.pc;
+            record->opcode = static_cast<uint16_t>(state.memory[address] << 8 | state.memory[(address + 1) & 0x0FFF]);
+            memcpy(previousV, state.V, sizeof(previousV));
+            return true;
+        }
+
+        bool after(Chip8& chip8) {
+            const Chip8State& state = chip8.getState();
+            record->changed = changedRegisters(previousV, state.V);
+            record->I = state.I;
+            memcpy(record->V, state.V, sizeof(record->V));
+            if constexpr (Inner::enabled)
+                return inner.after(chip8);
+            return true;
+        }
+
+    private:
+        Chip8Trace& trace;
+        Inner& inner;
+        Chip8Trace::Record* record;
+        uint8_t previousV[16];
+    };
+}
+
+inline void Chip8::step() {
+    executeNext();
+    ++state->cycleCount;
+}
+
+void Chip8::cycle() {
+    if (!trace) {
+        step();
+        return;
+    }
+    Chip8NoHooks none;
+    TraceHooks<Chip8NoHooks> traced(*trace, none);
+    traced.before(*this);
+    step();
+    traced.after(*this);
+}
+
+template<bool CheckStops, typename Hooks>
+Chip8::RunResult Chip8::runLoop(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask) {
+    events = 0;
+    faultHalt = false;
+    uint64_t executed = 0;
+
+    while (executed < maxCycles) {
+        if constexpr (Hooks::enabled) {
+            if (!hooks.before(*this))
+                return { StopReason::Breakpoint, executed };
+        }
+
+        step();
+        ++executed;
+
+        if constexpr (Hooks::enabled) {
+            if (!hooks.after(*this))
+                return { StopReason::Breakpoint, executed };
+        }
+
+        uint32_t stop = CheckStops ? (events & stopMask) : 0;
+        if (stop) {
+            StopReason reason = (stop & StopOnDraw)    ? StopReason::Draw
+                              : (stop & StopOnSound)   ? StopReason::SoundStart
+                              : (stop & StopOnKeyWait) ? StopReason::KeyWait
+                                                       : StopReason::UnknownOpcode;
+            return { reason, executed };
+        }
+
+        if (idleCheck) {
+            idleCheck = false;
+            if (faultHalt) {
+                faultHalt = false;
+                return { StopReason::UnknownOpcode, executed };
+            }
+            // Hooks (traces included) see every instruction, so nothing is skipped for them
+            uint64_t wake = Hooks::enabled ? state->cycleCount : sleepingUntil();
+            if (wake != state->cycleCount) {
+                // Only a key press ends this wait, so never spin forever
+                if (wake == noWake && ((stopMask & StopOnIdle) || maxCycles == UINT64_MAX))
+                    return { StopReason::Idle, executed };
+                executed += skipIdle(wake, maxCycles - executed);
+            }
+        }
+    }
+
+    return { StopReason::CycleLimit, executed };
+}
+
+template<bool CheckStops, typename Hooks>
+Chip8::RunResult Chip8::runTraced(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask) {
+    if (trace) {
+        TraceHooks<Hooks> traced(*trace, hooks);
+        return runLoop<CheckStops>(traced, maxCycles, stopMask);
+    }
+    return runLoop<CheckStops>(hooks, maxCycles, stopMask);
+}
+
+template<typename Hooks>
+Chip8::RunResult Chip8::run(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask) {
+    return stopMask ? runTraced<true>(hooks, maxCycles, stopMask) : runTraced<false>(hooks, maxCycles, 0);
+}
+
+template Chip8::RunResult Chip8::run<Chip8NoHooks>(Chip8NoHooks&, uint64_t, uint32_t);
+template Chip8::RunResult Chip8::run<Chip8Debugger>(Chip8Debugger&, uint64_t, uint32_t);
+template Chip8::RunResult Chip8::run<Chip8Timing>(Chip8Timing&, uint64_t, uint32_t);
+
+uint64_t Chip8::sleepingUntil() const {
+    uint16_t address = state->pc & 0x0FFF;
+    if ((address & 1) || address > 0x0FFA)
+        return state->cycleCount;
+
+    uint16_t first = state->memory[address] << 8 | state->memory[address + 1];
+    uint16_t second = state->memory[address + 2] << 8 | state->memory[address + 3];
+    uint16_t third = state->memory[address + 4] << 8 | state->memory[address + 5];
+
+    // FX0A with no key down
+    if ((first & 0xF0FF) == 0xF00A) {
+        for (int i = 0; i < 16; ++i) {
+            if (state->key[i] != 0)
+                return state->cycleCount;
+        }
+        return noWake;
+    }
+
+    // Jump to self
+    if (first == (0x1000 | address))
+        return noWake;
+
+    // FX07, 3X00, jump back to the FX07: spins until the delay timer expires
+    if ((first & 0xF0FF) == 0xF007 && second == (0x3000 | (first & 0x0F00)) &&
+        third == (0x1000 | address)) {
+        uint64_t expiry = (state->delayTick + state->delayValue) * state->cyclesPerTick;
+        if (expiry > state->cycleCount)
+            return expiry;
+    }
+
+    return state->cycleCount;
+}
+
+uint64_t Chip8::skipIdle(uint64_t wake, uint64_t budget) {
+    if (wake == noWake) {
+        // The skipped instructions are an FX0A or a jump to self; FX0A
+        // leaves the machine waiting for a key
+        if (budget > 0 && (state->memory[state->pc & 0x0FFF] & 0xF0) == 0xF0)
+            state->waitingForKey = true;
+        state->cycleCount += budget;
+        skippedCycles += budget;
+        return budget;
+    }
+
+    // Skip the poll iterations that would still read a nonzero timer, three
+    // instructions each, and leave VX as the last of them would
+    uint64_t iterations = std::min((wake - state->cycleCount + 2) / 3, budget / 3);
+    if (iterations == 0)
+        return 0;
+
+    uint8_t x = state->memory[state->pc & 0x0FFF] & 0x0F;
+    state->cycleCount += 3 * iterations;
+    skippedCycles += 3 * iterations;
+    state->V[x] = timerValue(state->delayValue, state->delayTick, (state->cycleCount - 3) / state->cyclesPerTick);
+    return 3 * iterations;
+}
+
+Chip8::RunResult Chip8::runCycles(uint64_t cycles) {
+    Chip8NoHooks hooks;
+    return runTraced<false>(hooks, cycles, 0);
+}
+
+Chip8::RunResult Chip8::runFrame(int instructionsPerFrame) {
+    if (instructionsPerFrame > 0 && static_cast<uint32_t>(instructionsPerFrame) != state->cyclesPerTick)
+        setCyclesPerTimerTick(instructionsPerFrame);
+
+    // Finish the current frame, which is normally a whole frame
+    Chip8NoHooks hooks;
+    return runTraced<false>(hooks, state->cyclesPerTick - state->cycleCount % state->cyclesPerTick, 0);
+}
+
+Chip8::RunResult Chip8::runUntil(uint32_t stopMask, uint64_t maxCycles) {
+    Chip8NoHooks hooks;
+    return runTraced<true>(hooks, maxCycles, stopMask);
+}
+
+void Chip8::opUnknown(Chip8& c, const Instruction& in) {
+    c.events |= StopOnUnknownOpcode;
+    Chip8Faults::Fault fault = { c.state->cycleCount, static_cast<uint16_t>(c.state->pc & 0x0FFF), in.opcode };
+    if (c.faults.record(c, fault)) {
+        c.state->pc += 2;
+    } else {
+        // Halt on it; the run loop picks this up with its idle check
+        c.faultHalt = true;
+        c.idleCheck = true;
     }
 }
 
+void Chip8::op00E0(Chip8& c, const Instruction&) { // 0x00E0: Clear display
+    memset(c.state->gfx, 0, sizeof(c.state->gfx));
+    c.staleRows = ~0u;
+    c.dirtyRows = ~0u;
+    c.drawFlag = true;
+    c.events |= StopOnDraw;
+    c.state->pc += 2;
+}
+
+void Chip8::op00EE(Chip8& c, const Instruction&) { // 0x00EE: Return from subroutine
+    --c.state->sp;
+    c.state->pc = c.state->stack[c.state->sp & 0xF];
+    c.state->pc += 2;
+}
+
+void Chip8::op1NNN(Chip8& c, const Instruction& in) { // 0x1NNN: Jump to address NNN
+    if (in.nnn <= c.state->pc)
+        c.idleCheck = true; // Loops jump backwards
+    c.state->pc = in.nnn;
+}
+
+void Chip8::op2NNN(Chip8& c, const Instruction& in) { // 0x2NNN: Call subroutine at NNN
+    c.state->stack[c.state->sp & 0xF] = c.state->pc;
+    ++c.state->sp;
+    c.state->pc = in.nnn;
+}
+
+void Chip8::op3XNN(Chip8& c, const Instruction& in) { // 0x3XNN: Skip next instruction if VX equals NN
+    c.state->pc += (c.state->V[in.x] == in.nn) ? 4 : 2;
+}
+
+void Chip8::op4XNN(Chip8& c, const Instruction& in) { // 0x4XNN: Skip next instruction if VX doesn't equal NN
+    c.state->pc += (c.state->V[in.x] != in.nn) ? 4 : 2;
+}
+
+void Chip8::op5XY0(Chip8& c, const Instruction& in) { // 0x5XY0: Skip next instruction if VX equals VY
+    c.state->pc += (c.state->V[in.x] == c.state->V[in.y]) ? 4 : 2;
+}
+
+void Chip8::op6XNN(Chip8& c, const Instruction& in) { // 0x6XNN: Set VX to NN
+    c.state->V[in.x] = in.nn;
+    c.state->pc += 2;
+}
+
+void Chip8::op7XNN(Chip8& c, const Instruction& in) { // 0x7XNN: Add NN to VX
+    c.state->V[in.x] += in.nn;
+    c.state->pc += 2;
+}
+
+void Chip8::op8XY0(Chip8& c, const Instruction& in) { // 0x8XY0: Set VX to the value of VY
+    c.state->V[in.x] = c.state->V[in.y];
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::op8XY1(Chip8& c, const Instruction& in) { // 0x8XY1: Set VX to VX or VY
+    c.state->V[in.x] |= c.state->V[in.y];
+    if constexpr (Quirks::logicResetsVF)
+        c.state->V[0xF] = 0;
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::op8XY2(Chip8& c, const Instruction& in) { // 0x8XY2: Set VX to VX and VY
+    c.state->V[in.x] &= c.state->V[in.y];
+    if constexpr (Quirks::logicResetsVF)
+        c.state->V[0xF] = 0;
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::op8XY3(Chip8& c, const Instruction& in) { // 0x8XY3: Set VX to VX xor VY
+    c.state->V[in.x] ^= c.state->V[in.y];
+    if constexpr (Quirks::logicResetsVF)
+        c.state->V[0xF] = 0;
+    c.state->pc += 2;
+}
+
+void Chip8::op8XY4(Chip8& c, const Instruction& in) { // 0x8XY4: Add VY to VX, VF = carry
+    uint16_t sum = c.state->V[in.x] + c.state->V[in.y];
+    c.state->V[0xF] = (sum > 255) ? 1 : 0;
+    c.state->V[in.x] = sum & 0xFF;
+    c.state->pc += 2;
+}
+
+void Chip8::op8XY5(Chip8& c, const Instruction& in) { // 0x8XY5: Subtract VY from VX, VF = NOT borrow
+    c.state->V[0xF] = (c.state->V[in.x] > c.state->V[in.y]) ? 1 : 0;
+    c.state->V[in.x] -= c.state->V[in.y];
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::op8XY6(Chip8& c, const Instruction& in) { // 0x8XY6: Shift VX (or VY) right by one, VF = LSB
+    if constexpr (Quirks::shiftUsesVY)
+        c.state->V[in.x] = c.state->V[in.y];
+    c.state->V[0xF] = c.state->V[in.x] & 0x1;
+    c.state->V[in.x] >>= 1;
+    c.state->pc += 2;
+}
+
+void Chip8::op8XY7(Chip8& c, const Instruction& in) { // 0x8XY7: Set VX to VY minus VX, VF = NOT borrow
+    c.state->V[0xF] = (c.state->V[in.y] > c.state->V[in.x]) ? 1 : 0;
+    c.state->V[in.x] = c.state->V[in.y] - c.state->V[in.x];
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::op8XYE(Chip8& c, const Instruction& in) { // 0x8XYE: Shift VX (or VY) left by one, VF = MSB
+    if constexpr (Quirks::shiftUsesVY)
+        c.state->V[in.x] = c.state->V[in.y];
+    c.state->V[0xF] = c.state->V[in.x] >> 7;
+    c.state->V[in.x] <<= 1;
+    c.state->pc += 2;
+}
+
+void Chip8::op9XY0(Chip8& c, const Instruction& in) { // 0x9XY0: Skip next instruction if VX doesn't equal VY
+    c.state->pc += (c.state->V[in.x] != c.state->V[in.y]) ? 4 : 2;
+}
+
+void Chip8::opANNN(Chip8& c, const Instruction& in) { // 0xANNN: Set I to the address NNN
+    c.state->I = in.nnn;
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::opBNNN(Chip8& c, const Instruction& in) { // 0xBNNN: Jump to the address NNN plus V0 (or VX)
+    c.state->pc = in.nnn + c.state->V[Quirks::jumpUsesVX ? in.x : 0];
+}
+
+void Chip8::opCXNN(Chip8& c, const Instruction& in) { // 0xCXNN: Set VX to a random number masked by NN
+    c.state->V[in.x] = c.getRandom() & in.nn;
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::opDXYN(Chip8& c, const Instruction& in) { // 0xDXYN: Draw sprite at (VX, VY) with N bytes of sprite data starting at I
+    unsigned x = c.state->V[in.x] % 64;
+    unsigned y = c.state->V[in.y];
+    uint64_t collision = 0;
+    uint32_t rows = 0;
+
+    // Each sprite byte becomes one framebuffer row: rotate it into place
+    // (wrapping at the right edge, or shift it and lose what falls off),
+    // test for collision and XOR it in
+    int lines = in.n;
+    if constexpr (Quirks::clipSprites) {
+        y %= 32;
+        lines = std::min<int>(lines, 32 - y);
+    }
+    for (int yline = 0; yline < lines; yline++) {
+        int py = (y + yline) % 32;
+        uint64_t sprite = uint64_t(c.state->memory[(c.state->I + yline) & 0x0FFF]) << 56;
+        uint64_t row = Quirks::clipSprites ? sprite >> x : rotateRight(sprite, x);
+        collision |= c.state->gfx[py] & row;
+        c.state->gfx[py] ^= row;
+        if (row)
+            rows |= 1u << py;
+    }
+
+    c.state->V[0xF] = collision != 0;
+    c.staleRows |= rows;
+    c.dirtyRows |= rows;
+    c.drawFlag = true;
+    c.events |= StopOnDraw;
+    c.state->pc += 2;
+}
+
+const uint32_t* Chip8::getDisplay() {
+    for (int row = 0; staleRows != 0; ++row, staleRows >>= 1) {
+        if (staleRows & 1)
+            updateDisplayRow(row);
+    }
+    return display;
+}
+
+uint32_t Chip8::takeDirtyRows() {
+    uint32_t rows = dirtyRows;
+    dirtyRows = 0;
+    return rows;
+}
+
+void Chip8::updateDisplayRow(int row) {
+    Chip8Expand::expandRow(state->gfx[row], 0x00000000, 0xFFFFFFFF, display + row * 64);
+}
+
+void Chip8::opEX9E(Chip8& c, const Instruction& in) { // 0xEX9E: Skip next instruction if key stored in VX is pressed
+    c.state->pc += (c.state->key[c.state->V[in.x] & 0xF] != 0) ? 4 : 2;
+}
+
+void Chip8::opEXA1(Chip8& c, const Instruction& in) { // 0xEXA1: Skip next instruction if key stored in VX isn't pressed
+    c.state->pc += (c.state->key[c.state->V[in.x] & 0xF] == 0) ? 4 : 2;
+}
+
+void Chip8::opFX07(Chip8& c, const Instruction& in) { // 0xFX07: Set VX to the value of the delay timer
+    c.state->V[in.x] = c.delayTimer();
+    c.state->pc += 2;
+}
+
+void Chip8::opFX0A(Chip8& c, const Instruction& in) { // 0xFX0A: Wait for a key press, store the value of the key in VX
+    for (int i = 0; i < 16; ++i) {
+        if (c.state->key[i] != 0) {
+            c.state->V[in.x] = i;
+            c.state->waitingForKey = false;
+            c.state->pc += 2;
+            return;
+        }
+    }
+    c.state->waitingForKey = true; // Don't increment pc, wait for key press
+    c.events |= StopOnKeyWait;
+    c.idleCheck = true;
+}
+
+void Chip8::opFX15(Chip8& c, const Instruction& in) { // 0xFX15: Set the delay timer to VX
+    c.setDelayTimer(c.state->V[in.x]);
+    c.state->pc += 2;
+}
+
+void Chip8::opFX18(Chip8& c, const Instruction& in) { // 0xFX18: Set the sound timer to VX
+    if (c.state->V[in.x] != 0 && c.soundTimer() == 0) {
+        c.soundFlag = true;
+        c.events |= StopOnSound;
+    }
+    c.setSoundTimer(c.state->V[in.x]);
+    c.state->pc += 2;
+}
+
+void Chip8::opFX1E(Chip8& c, const Instruction& in) { // 0xFX1E: Add VX to I
+    c.state->I += c.state->V[in.x];
+    c.state->pc += 2;
+}
+
+void Chip8::opFX29(Chip8& c, const Instruction& in) { // 0xFX29: Set I to the location of the sprite for character in VX
+    c.state->I = c.state->V[in.x] * 0x5;
+    c.state->pc += 2;
+}
+
+void Chip8::opFX33(Chip8& c, const Instruction& in) { // 0xFX33: Store binary-coded decimal representation of VX at I, I+1, I+2
+    uint8_t value = c.state->V[in.x];
+    c.state->memory[c.state->I & 0x0FFF] = value / 100;
+    c.state->memory[(c.state->I + 1) & 0x0FFF] = (value / 10) % 10;
+    c.state->memory[(c.state->I + 2) & 0x0FFF] = (value % 100) % 10;
+    c.invalidateCode(c.state->I, 3);
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::opFX55(Chip8& c, const Instruction& in) { // 0xFX55: Store registers V0 through VX in memory starting at location I
+    for (int i = 0; i <= in.x; ++i)
+        c.state->memory[(c.state->I + i) & 0x0FFF] = c.state->V[i];
+    c.invalidateCode(c.state->I, in.x + 1);
+    advanceIndex<Quirks>(c, in);
+    c.state->pc += 2;
+}
+
+template<typename Quirks>
+void Chip8::opFX65(Chip8& c, const Instruction& in) { // 0xFX65: Read registers V0 through VX from memory starting at location I
+    for (int i = 0; i <= in.x; ++i)
+        c.state->V[i] = c.state->memory[(c.state->I + i) & 0x0FFF];
+    advanceIndex<Quirks>(c, in);
+    c.state->pc += 2;
+}
+
+// Translated code calls these directly, see chip8_recompile
+template void Chip8::opDXYN<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>(Chip8&, const Instruction&);
+template void Chip8::opFX55<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>(Chip8&, const Instruction&);
+
+void Chip8::setCyclesPerTimerTick(int cyclesPerTick) {
+    if (cyclesPerTick < 1)
+        return;
+
+    // Carry the current timer values over to the new tick length
+    uint8_t delay = delayTimer();
+    uint8_t sound = soundTimer();
+    state->cyclesPerTick = static_cast<uint32_t>(cyclesPerTick);
+    setDelayTimer(delay);
+    setSoundTimer(sound);
+}
+
 void Chip8::setKey(int key, bool pressed) {
     if (key >= 0 && key < 16) {
-        this->key[key] = pressed ? 1 : 0;
+        state->key[key] = pressed ? 1 : 0;
     }
 }
 
 uint8_t Chip8::getRandom() {
-    return static_cast<uint8_t>(dis(gen));
+    return randomSource ? randomSource->nextByte() : state->rng.nextByte();
 }
 
 bool Chip8::shouldPlaySound() const {
-    return sound_timer > 0;
+    return soundTimer() > 0;
 }
@@ -1,47 +1,336 @@
 #pragma once
+#include "Chip8Faults.h"
+#include "Chip8Quirks.h"
+#include "Chip8Random.h"
+#include "Chip8State.h"
+#include <cstddef>
 #include <cstdint>
-#include <random>
+#include <vector>
+
+class Chip8Aot;
+class Chip8Profile;
+class Chip8Trace;
+class Chip8Debugger;
+class Chip8;
+
+// Notified when memory that may hold translated code is written. A written
+// range never runs past 0xFFF; a write that wraps arrives as two calls.
+class Chip8CodeObserver {
+public:
+    virtual ~Chip8CodeObserver() {}
+    virtual void codeWritten(uint16_t address, int length) = 0;
+    virtual void codeReset() = 0;
+};
+
+// Hooks policy that does nothing; every hook compiles away. See Chip8::run().
+struct Chip8NoHooks {
+    static constexpr bool enabled = false;
+    bool before(Chip8&) { return true; }
+    bool after(Chip8&) { return true; }
+};
+
+// Opcode dispatch is table driven by default. Define CHIP8_SWITCH_DISPATCH
+// to decode through a plain switch instead (useful for benchmarking).
 
 class Chip8 {
 public:
-    Chip8();    void loadRom(const char* filename);
+    Chip8();    bool loadRom(const char* filename);    // False if unreadable or too large
+    bool loadRom(const uint8_t* data, size_t size);  // ROM image already in memory
+
+    // Run on an external machine state instead of the built-in one. The
+    // state is used as is; resetState() gives it power-on contents.
+    explicit Chip8(Chip8State& state);
+    void attach(Chip8State& state);
+    Chip8State& getState() { return *state; }
+    const Chip8State& getState() const { return *state; }
+    static void resetState(Chip8State& state);
+
+    // Snapshots for rewind, run-ahead and search. snapshot() is one copy of
+    // the machine state; restore() copies it back and re-decodes only the
+    // memory blocks and display rows that differ from the current state.
+    void snapshot(Chip8State& out) const;
+    void restore(const Chip8State& snapshot);
+
+    // Versioned binary save, see Chip8SaveState. loadState() leaves the
+    // machine alone and returns false if `data` is not a usable save.
+    std::vector<uint8_t> saveState() const;
+    bool loadState(const uint8_t* data, size_t size);
+
+    Chip8(const Chip8&) = delete;
+    Chip8& operator=(const Chip8&) = delete;
+
     void cycle();    void setKey(int key, bool pressed);
     bool shouldPlaySound() const;  // Check if sound should be playing
-    void enableDebugMode(bool enabled) { debugMode = enabled; } // Enable debug output
-    
+
+    // Record every instruction into `trace`, see Chip8Trace. While a trace
+    // is attached busy waits are executed rather than fast-forwarded, and
+    // translated code falls back to the interpreter, so nothing is missed.
+    // Not owned by Chip8; nullptr detaches.
+    void setTrace(Chip8Trace* newTrace) { trace = newTrace; }
+
+    // Unknown opcode counters and policy, see Chip8Faults. Under the Halt
+    // policy (or a trap that halts) pc stays on the instruction and the run
+    // calls below return StopReason::UnknownOpcode right after it.
+    Chip8Faults& getFaults() { return faults; }
+    const Chip8Faults& getFaults() const { return faults; }
+
+    // Opcode interpretation, see Chip8Quirks. Switching profiles drops the
+    // decoded code. Like the timer rate, the profile is a setting of this
+    // host, not part of the machine state.
+    void setQuirks(Chip8Quirks::Profile profile);
+    Chip8Quirks::Profile getQuirks() const { return quirks; }
+
+    // Batch execution. Each call runs until its cycle budget is used up or
+    // one of the requested stop conditions occurs.
+    enum StopCondition : uint32_t {
+        StopOnDraw           = 1 << 0,  // 00E0 or DXYN changed the display
+        StopOnSound          = 1 << 1,  // FX18 started the sound timer
+        StopOnKeyWait        = 1 << 2,  // FX0A is blocked waiting for a key
+        StopOnUnknownOpcode  = 1 << 3,
+        StopOnIdle           = 1 << 4,  // Nothing but a key press can wake it
+    };
+
+    enum class StopReason {
+        CycleLimit,
+        Draw,
+        SoundStart,
+        KeyWait,
+        UnknownOpcode,          // Halted on an unknown opcode, or StopOnUnknownOpcode
+        Idle,
+        Breakpoint,             // A hook stopped the run, see run()
+    };
+
+    struct RunResult {
+        StopReason reason;
+        uint64_t cycles;        // Instructions executed by this call
+    };
+
+    RunResult runCycles(uint64_t cycles);
+    RunResult runFrame(int instructionsPerFrame); // Runs to the next timer tick
+    RunResult runUntil(uint32_t stopMask, uint64_t maxCycles = UINT64_MAX);
+
+    // The same loop with a hooks policy compiled in. A policy provides
+    //   static constexpr bool enabled;
+    //   bool before(Chip8&);   // false stops before the instruction at pc
+    //   bool after(Chip8&);    // false stops after the instruction just run
+    // and a stop returns StopReason::Breakpoint. While hooks are enabled
+    // busy waits are executed rather than fast-forwarded. The calls above
+    // use Chip8NoHooks. With a trace attached, every call wraps its policy
+    // in the tracing one. Instantiated in Chip8.cpp for Chip8NoHooks,
+    // Chip8Debugger and Chip8Timing.
+    template<typename Hooks>
+    RunResult run(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask = 0);
+
+    // Busy waits are fast-forwarded by the run calls above instead of being
+    // executed. sleepingUntil() is the cycle at which the program can next
+    // make progress by itself: getCycleCount() while running, the delay
+    // timer expiry in an FX07 / 3X00 / 1NNN poll, and noWake while FX0A
+    // waits for a key or the program jumps to itself.
+    static constexpr uint64_t noWake = UINT64_MAX;
+    uint64_t sleepingUntil() const;
+    // Instructions fast-forwarded so far by this host, on any attached
+    // state. They are part of getCycleCount() but were never executed.
+    uint64_t getSkippedCycles() const { return skippedCycles; }
+
+    // CXNN randomness. Instances start from a fixed seed, so runs are
+    // reproducible unless the frontend seeds them. An attached source
+    // replaces the built-in generator and is not owned by Chip8.
+    void seedRandom(uint64_t seed) { state->rng.reseed(seed); }
+    Chip8Random::State getRandomState() const { return state->rng.getState(); }
+    void setRandomState(const Chip8Random::State& newState) { state->rng.setState(newState); }
+    void setRandomSource(Chip8RandomSource* source) { randomSource = source; }
+
+    // Execution profiling, see Chip8Profile. The hook is only compiled in
+    // with CHIP8_PROFILE; otherwise an attached profile stays empty and
+    // the interpreter loop is unchanged. Not owned by Chip8.
+#ifdef CHIP8_PROFILE
+    static constexpr bool profilingEnabled = true;
+#else
+    static constexpr bool profilingEnabled = false;
+#endif
+    void setProfile(Chip8Profile* newProfile) { profile = newProfile; }
+
+    // Instruction families as the decoder sees them, one per handler.
+    // Family 0 is every opcode that has no handler.
+    static constexpr int opcodeFamilyCount = 35;
+    static int opcodeFamily(uint16_t opcode);
+    static const char* opcodeFamilyName(int family);    // e.g. "8XY4"
+
+    // Timers count down at 60 Hz of emulated time, i.e. once every
+    // `cyclesPerTick` instructions. runFrame() also sets this rate.
+    void setCyclesPerTimerTick(int cyclesPerTick);
+    uint64_t getCycleCount() const { return state->cycleCount; }
+
+    // 64x32 pixels, 0xFFFFFFFF = on. Rows changed since the previous call
+    // are converted from the packed framebuffer first.
+    const uint32_t* getDisplay();
+    // Rows changed since the previous call, bit n = row n
+    uint32_t takeDirtyRows();
+    // Packed framebuffer, see Chip8Expand
+    const uint64_t* getFramebuffer() const { return state->gfx; }
+
     // Public members for display and audio
-    uint32_t display[64 * 32];  // 64x32 pixel display
     bool drawFlag;
-    bool soundFlag;
-    
+    bool soundFlag;             // Set when the sound timer starts
+
+    // Operand fields of an opcode, extracted once per fetch
+    struct Instruction {
+        uint16_t opcode;
+        uint16_t nnn;           // Address (lowest 12 bits)
+        uint8_t x;              // Register index (bits 8-11)
+        uint8_t y;              // Register index (bits 4-7)
+        uint8_t n;              // Lowest 4 bits
+        uint8_t nn;             // Lowest 8 bits
+    };
+
 private:
-    // CPU registers
-    uint8_t V[16];              // 16 8-bit registers V0-VF
-    uint16_t I;                 // Index register
-    uint16_t pc;                // Program counter
-    uint8_t sp;                 // Stack pointer
-    uint16_t stack[16];         // Stack
-    
-    // Memory and graphics
-    uint8_t memory[4096];       // 4K memory
-    uint8_t gfx[64 * 32];       // Graphics buffer
-    
-    // Timers
-    uint8_t delay_timer;
-    uint8_t sound_timer;
-    
-    // Input
-    uint8_t key[16];            // Keypad state
-    
-    // Random number generator
-    std::random_device rd;
-    std::mt19937 gen;
-    std::uniform_int_distribution<> dis;
+    friend class Chip8Aot;
+
+    // Emulated machine, either localState or one attached from outside
+    Chip8State* state;
+    Chip8State localState;
+
+    // Display conversion
+    uint32_t display[64 * 32];  // gfx expanded to pixels by getDisplay()
+    uint32_t staleRows;         // Rows of display[] that lag behind gfx
+    uint32_t dirtyRows;         // Rows changed since takeDirtyRows()
+
+    static uint64_t rotateRight(uint64_t value, unsigned count) {
+        return (value >> count) | (value << ((64 - count) & 63));
+    }
+    void updateDisplayRow(int row);
+
+    // Timer access, see Chip8State
+    uint64_t currentTick() const { return state->cycleCount / state->cyclesPerTick; }
+    static uint8_t timerValue(uint8_t value, uint64_t setTick, uint64_t now) {
+        uint64_t elapsed = now - setTick;
+        return elapsed >= value ? 0 : static_cast<uint8_t>(value - elapsed);
+    }
+    uint8_t delayTimer() const { return timerValue(state->delayValue, state->delayTick, currentTick()); }
+    uint8_t soundTimer() const { return timerValue(state->soundValue, state->soundTick, currentTick()); }
+    void setDelayTimer(uint8_t value) { state->delayValue = value; state->delayTick = currentTick(); }
+    void setSoundTimer(uint8_t value) { state->soundValue = value; state->soundTick = currentTick(); }
+
+    // StopCondition bits raised since the current run started
+    uint32_t events;
+    bool idleCheck;             // Backward jump or key wait, pc may be idle
+    bool faultHalt;             // Halted on an unknown opcode, stop the run
+
+    Chip8Faults faults;
+
+    // Attached replacement for the state's random generator, if any
+    Chip8RandomSource* randomSource;
+    Chip8Profile* profile;
+    Chip8Trace* trace;
       // Helper methods
     void initialize();
-    void loadFontset();
+    void resetHost();
     uint8_t getRandom();
-    
-    // Debug mode
-    bool debugMode;
-};
\ No newline at end of file
+
+    // Instruction decoding and dispatch
+    using OpHandler = void (*)(Chip8& c, const Instruction& in);
+    struct Dispatch;            // Compile-time generated opcode table (Chip8.cpp)
+
+    // Handlers of the selected quirk profile, one per Dispatch slot, and
+    // its instantiation of the switch decoder
+    Chip8Quirks::Profile quirks;
+    const OpHandler* handlers;
+    void (Chip8::*executeSwitch)(const Instruction& in);
+    template<typename Quirks>
+    void useQuirks();
+
+    void step();
+    void dispatch();            // Execute the instruction at pc
+    void executeNext();         // dispatch(), through the profiler if built in
+    bool profileStep();         // CHIP8_PROFILE builds only
+    template<bool CheckStops, typename Hooks>
+    RunResult runLoop(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask);
+    template<bool CheckStops, typename Hooks>
+    RunResult runTraced(Hooks& hooks, uint64_t maxCycles, uint32_t stopMask);  // runLoop(), traced if attached
+    uint64_t skipIdle(uint64_t wake, uint64_t budget);
+
+    static Instruction decode(uint16_t opcode);
+    OpHandler lookupHandler(uint16_t opcode) const;
+    void execute(const Instruction& in);
+    template<typename Quirks>
+    void executeAs(const Instruction& in);      // The switch decoder
+
+    // Predecoded instruction cache, one entry per even address. Entries
+    // start out (and are reset to) opDecode, which fills them on first use.
+    struct CacheEntry {
+        OpHandler handler;
+        Instruction in;
+    };
+    CacheEntry decodeCache[4096 / 2];
+    // Entries opDecode() filled since the last full reset, so that
+    // invalidateAllCode() (every attach()) only resets those; -1 once the
+    // list is lost and the whole cache has to be reset
+    uint16_t decodedEntries[4096 / 2];
+    int decodedCount;
+
+    void invalidateCode(uint16_t address, int length);
+    void invalidateAllCode();
+    static void opDecode(Chip8& c, const Instruction& in);
+
+    // Translation backend attached to this instance, if any
+    Chip8CodeObserver* codeObserver;
+
+    // Instructions fast-forwarded by skipIdle(), see getSkippedCycles()
+    uint64_t skippedCycles;
+
+    // Opcode handlers, one per instruction pattern. Those that depend on
+    // quirks are instantiated for every Chip8Quirks profile.
+    static void opUnknown(Chip8& c, const Instruction& in);
+    static void op00E0(Chip8& c, const Instruction& in);
+    static void op00EE(Chip8& c, const Instruction& in);
+    static void op1NNN(Chip8& c, const Instruction& in);
+    static void op2NNN(Chip8& c, const Instruction& in);
+    static void op3XNN(Chip8& c, const Instruction& in);
+    static void op4XNN(Chip8& c, const Instruction& in);
+    static void op5XY0(Chip8& c, const Instruction& in);
+    static void op6XNN(Chip8& c, const Instruction& in);
+    static void op7XNN(Chip8& c, const Instruction& in);
+    static void op8XY0(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void op8XY1(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void op8XY2(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void op8XY3(Chip8& c, const Instruction& in);
+    static void op8XY4(Chip8& c, const Instruction& in);
+    static void op8XY5(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void op8XY6(Chip8& c, const Instruction& in);
+    static void op8XY7(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void op8XYE(Chip8& c, const Instruction& in);
+    static void op9XY0(Chip8& c, const Instruction& in);
+    static void opANNN(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void opBNNN(Chip8& c, const Instruction& in);
+    static void opCXNN(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void opDXYN(Chip8& c, const Instruction& in);
+    static void opEX9E(Chip8& c, const Instruction& in);
+    static void opEXA1(Chip8& c, const Instruction& in);
+    static void opFX07(Chip8& c, const Instruction& in);
+    static void opFX0A(Chip8& c, const Instruction& in);
+    static void opFX15(Chip8& c, const Instruction& in);
+    static void opFX18(Chip8& c, const Instruction& in);
+    static void opFX1E(Chip8& c, const Instruction& in);
+    static void opFX29(Chip8& c, const Instruction& in);
+    static void opFX33(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void opFX55(Chip8& c, const Instruction& in);
+    template<typename Quirks>
+    static void opFX65(Chip8& c, const Instruction& in);
+
+    // I after FX55 / FX65
+    template<typename Quirks>
+    static void advanceIndex(Chip8& c, const Instruction& in) {
+        if constexpr (Quirks::index == Chip8Quirks::Index::AddX)
+            c.state->I += in.x;
+        else if constexpr (Quirks::index == Chip8Quirks::Index::AddXPlusOne)
+            c.state->I += in.x + 1;
+    }
+};
@@ -0,0 +1,87 @@
+#include "Chip8Aot.h"
+
+Chip8Aot::Chip8Aot(Chip8& chip8) : chip8(chip8), translatedCycles(0) {
+    reset();
+    chip8.codeObserver = this;
+}
+
+Chip8Aot::~Chip8Aot() {
+    if (chip8.codeObserver == this)
+        chip8.codeObserver = nullptr;
+}
+
+int Chip8Aot::run(int cycles) {
+    int executed = 0;
+    // Translated code has the default quirks built in
+    bool translated = chip8.quirks == Chip8Quirks::Profile::Default;
+
+    while (executed < cycles) {
+        uint16_t pc = chip8.state->pc;
+
+        if (translated && !(pc & 1) && pc < 4096 && !chip8.trace) {
+            const Entry& entry = entryAt[pc >> 1];
+            if (entry.block) {
+                int ran = entry.block->run(chip8, entry.index, cycles - executed);
+                executed += ran;
+                translatedCycles += ran;
+                continue;
+            }
+        }
+
+        // Not recompiled: interpreter fallback
+        chip8.cycle();
+        ++executed;
+    }
+
+    return executed;
+}
+
+void Chip8Aot::reset() {
+    for (Entry& entry : entryAt)
+        entry = { nullptr, 0 };
+    for (int i = 0; i < blockCount; ++i) {
+        if (matches(blocks[i]))
+            enable(blocks[i]);
+    }
+}
+
+void Chip8Aot::enable(const Block& block) {
+    // Blocks overlap where one jumps into another. An address where a block
+    // starts is entered through that block.
+    for (int i = 0; i < block.length; ++i) {
+        Entry& entry = entryAt[(block.address >> 1) + i];
+        if (!entry.block || entry.index != 0 || i == 0)
+            entry = { &block, i };
+    }
+}
+
+void Chip8Aot::codeWritten(uint16_t address, int length) {
+    // Disable blocks whose code no longer matches the ROM they came from.
+    // Chip8 splits writes that wrap, so the range ends by 0x1000.
+    int end = address + length;
+    for (int i = 0; i < blockCount; ++i) {
+        const Block& block = blocks[i];
+        int blockEnd = block.address + block.length * 2;
+        if (block.address >= end || address >= blockEnd)
+            continue;
+        // A block always owns the entry at its start while enabled
+        bool enabled = entryAt[block.address >> 1].block == &block;
+        bool valid = matches(block);
+        if (enabled && !valid) {
+            reset();    // Its other entries may belong to overlapping blocks
+            return;
+        }
+        if (!enabled && valid)
+            enable(block);
+    }
+}
+
+bool Chip8Aot::matches(const Block& block) const {
+    for (int i = 0; i < block.length * 2; ++i) {
+        int address = block.address + i;
+        int offset = address - 0x200;
+        if (offset < 0 || offset >= romSize || chip8.state->memory[address] != romImage[offset])
+            return false;
+    }
+    return true;
+}
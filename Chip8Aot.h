@@ -0,0 +1,60 @@
+#pragma once
+#include "Chip8.h"
+#include <cstdint>
+
+// Runtime for ROMs recompiled ahead of time by chip8_recompile. The
+// generated source defines the block table and one native function per
+// basic block discovered from 0x200. A block can be entered at any of its
+// instructions and stops when the cycle budget runs out, so it runs under
+// budgets of a few instructions too. Addresses outside every block, blocks
+// whose code has since been overwritten, and everything under a quirk
+// profile other than the default run through Chip8::cycle().
+class Chip8Aot : public Chip8CodeObserver {
+public:
+    explicit Chip8Aot(Chip8& chip8);
+    ~Chip8Aot() override;
+
+    Chip8Aot(const Chip8Aot&) = delete;
+    Chip8Aot& operator=(const Chip8Aot&) = delete;
+
+    // Execute up to `cycles` instructions, returns how many were executed
+    int run(int cycles);
+
+    // Instructions executed by recompiled code rather than the interpreter
+    uint64_t getTranslatedCycles() const { return translatedCycles; }
+
+    // Re-enable every block whose code in memory matches the recompiled ROM
+    void reset();
+
+    void codeWritten(uint16_t address, int length) override;
+    void codeReset() override { reset(); }
+
+    struct Block {
+        uint16_t address;       // Address of the first instruction
+        uint16_t length;        // Instructions in the block
+        // Runs from instruction `first` to the end of the block, or until
+        // `budget` instructions ran; returns how many ran
+        int (*run)(Chip8& c, int first, int budget);
+    };
+
+    // Defined by the generated source
+    template<uint16_t Address> static int block(Chip8& c, int first, int budget);
+    static const Block blocks[];
+    static const int blockCount;
+    static const uint8_t romImage[];
+    static const int romSize;
+
+private:
+    // Block to enter at an address, and the index of its instruction there
+    struct Entry {
+        const Block* block;
+        int index;
+    };
+
+    Chip8& chip8;
+    Entry entryAt[4096 / 2];
+    uint64_t translatedCycles;
+
+    bool matches(const Block& block) const;
+    void enable(const Block& block);
+};
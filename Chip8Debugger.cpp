@@ -0,0 +1,70 @@
+#include "Chip8Debugger.h"
+
+Chip8Debugger::Chip8Debugger() : observer(nullptr) {
+    clear();
+}
+
+void Chip8Debugger::clear() {
+    memset(flags, 0, sizeof(flags));
+    watched = 0;
+    resumeCycle = UINT64_MAX;
+    hit = { Hit::None, 0, 0 };
+}
+
+void Chip8Debugger::set(uint16_t address, int length, uint8_t flag, bool on) {
+    for (int i = 0; i < length; ++i) {
+        uint8_t& entry = flags[(address + i) & 0x0FFF];
+        bool wasWatched = (entry & (WatchRead | WatchWrite)) != 0;
+        entry = on ? (entry | flag) : (entry & ~flag);
+        watched += ((entry & (WatchRead | WatchWrite)) != 0) - wasWatched;
+    }
+}
+
+bool Chip8Debugger::checkAccess(const Chip8State& state) {
+    uint16_t address = state.pc & 0x0FFF;
+    uint16_t opcode = state.memory[address] << 8 | state.memory[(address + 1) & 0x0FFF];
+
+    // Data accessed by the instruction at pc, starting at I
+    uint8_t kind;
+    int length;
+    if ((opcode & 0xF000) == 0xD000) {
+        kind = WatchRead;
+        length = opcode & 0x000F;
+    } else if ((opcode & 0xF0FF) == 0xF033) {
+        kind = WatchWrite;
+        length = 3;
+    } else if ((opcode & 0xF0FF) == 0xF055) {
+        kind = WatchWrite;
+        length = ((opcode >> 8) & 0xF) + 1;
+    } else if ((opcode & 0xF0FF) == 0xF065) {
+        kind = WatchRead;
+        length = ((opcode >> 8) & 0xF) + 1;
+    } else {
+        return true;
+    }
+
+    for (int i = 0; i < length; ++i) {
+        uint16_t target = (state.I + i) & 0x0FFF;
+        if (flags[target] & kind) {
+            hit = { kind == WatchRead ? Hit::Read : Hit::Write, static_cast<uint16_t>(state.pc), target };
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Chip8Debugger::notifyChanges(Chip8& chip8) {
+    const Chip8State& state = chip8.getState();
+    bool stop = false;
+    for (int i = 0; i < 16; ++i) {
+        if (state.V[i] != previousV[i] && observer->registerChanged(chip8, i, previousV[i], state.V[i])) {
+            hit = { Hit::Register, pc, static_cast<uint16_t>(i) };
+            stop = true;
+        }
+    }
+    if (state.I != previousI && observer->registerChanged(chip8, registerI, previousI, state.I)) {
+        hit = { Hit::Register, pc, static_cast<uint16_t>(registerI) };
+        stop = true;
+    }
+    return !stop;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "Chip8.h"
+#include <cstdint>
+#include <cstring>
+
+// Notified by Chip8Debugger when an instruction changed a register.
+// `reg` is 0-15 for V0-VF or Chip8Debugger::registerI.
+class Chip8RegisterObserver {
+public:
+    virtual ~Chip8RegisterObserver() {}
+    // Return true to stop the run after this instruction
+    virtual bool registerChanged(Chip8& chip8, int reg, uint16_t oldValue, uint16_t newValue) = 0;
+};
+
+// Debugging hooks policy for Chip8::run(): PC breakpoints, memory read and
+// write watchpoints and register change notifications. Breakpoints and
+// watchpoints share one flag byte per address. Watchpoints catch the data
+// accesses of DXYN, FX33, FX55 and FX65, not instruction fetches, and stop
+// before the instruction that would make the access. Running again from a
+// stop steps over that instruction once.
+class Chip8Debugger {
+public:
+    static constexpr bool enabled = true;
+    static constexpr int registerI = 16;
+
+    enum Flag : uint8_t {
+        Break      = 1 << 0,
+        WatchRead  = 1 << 1,
+        WatchWrite = 1 << 2,
+    };
+
+    struct Hit {
+        enum Kind { None, Breakpoint, Read, Write, Register } kind;
+        uint16_t pc;            // Instruction that stopped the run
+        uint16_t address;       // Address accessed, or the register changed
+    };
+
+    Chip8Debugger();
+
+    void setBreakpoint(uint16_t address, bool on = true) { set(address, 1, Break, on); }
+    void watch(uint16_t address, int length, uint8_t flags, bool on = true) { set(address, length, flags, on); }
+    bool isBreakpoint(uint16_t address) const { return (flags[address & 0x0FFF] & Break) != 0; }
+    uint8_t watchFlags(uint16_t address) const { return flags[address & 0x0FFF] & (WatchRead | WatchWrite); }
+    void clear();
+
+    // Not owned by the debugger; nullptr detaches
+    void setRegisterObserver(Chip8RegisterObserver* newObserver) { observer = newObserver; }
+
+    const Hit& lastHit() const { return hit; }
+
+    // Policy hooks, called by Chip8::run()
+    bool before(Chip8& chip8) {
+        const Chip8State& state = chip8.getState();
+        if (state.cycleCount == resumeCycle) {
+            resumeCycle = UINT64_MAX;   // Step over the instruction that stopped us
+        } else if ((flags[state.pc & 0x0FFF] & Break) || (watched && !checkAccess(state))) {
+            if (flags[state.pc & 0x0FFF] & Break)
+                hit = { Hit::Breakpoint, static_cast<uint16_t>(state.pc), static_cast<uint16_t>(state.pc) };
+            resumeCycle = state.cycleCount;
+            return false;
+        }
+
+        if (observer) {
+            memcpy(previousV, state.V, sizeof(previousV));
+            previousI = state.I;
+            pc = state.pc;
+        }
+        return true;
+    }
+
+    bool after(Chip8& chip8) {
+        return !observer || notifyChanges(chip8);
+    }
+
+private:
+    uint8_t flags[4096];
+    int watched;                // Addresses with a watch flag set
+    uint64_t resumeCycle;
+    Hit hit;
+
+    Chip8RegisterObserver* observer;
+    uint8_t previousV[16];
+    uint16_t previousI;
+    uint16_t pc;
+
+    void set(uint16_t address, int length, uint8_t flag, bool on);
+    bool checkAccess(const Chip8State& state);      // False on a watchpoint hit
+    bool notifyChanges(Chip8& chip8);               // False if the observer stops
+};
@@ -0,0 +1,122 @@
+#include "Chip8Expand.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHIP8_EXPAND_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using RowKernel = void (*)(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest);
+
+void expandScalar(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest) {
+    uint32_t diff = off ^ on;
+    for (int x = 0; x < 64; ++x) {
+        uint32_t mask = 0u - static_cast<uint32_t>((bits >> (63 - x)) & 1);
+        dest[x] = off ^ (diff & mask);
+    }
+}
+
+#ifdef CHIP8_EXPAND_X86
+// Broadcast 4 (SSE2) or 8 (AVX2) bits to every lane, isolate one bit per
+// lane and turn it into a full lane mask that selects between the colours.
+
+__attribute__((target("sse2")))
+void expandSSE2(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest) {
+    const __m128i select = _mm_set_epi32(1, 2, 4, 8);
+    const __m128i offv = _mm_set1_epi32(static_cast<int>(off));
+    const __m128i diff = _mm_set1_epi32(static_cast<int>(off ^ on));
+    for (int i = 0; i < 16; ++i) {
+        int nibble = static_cast<int>((bits >> (60 - 4 * i)) & 0xF);
+        __m128i lanes = _mm_and_si128(_mm_set1_epi32(nibble), select);
+        __m128i mask = _mm_cmpeq_epi32(lanes, select);
+        __m128i pixels = _mm_xor_si128(offv, _mm_and_si128(diff, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4 * i), pixels);
+    }
+}
+
+__attribute__((target("avx2")))
+void expandAVX2(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest) {
+    const __m256i select = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i offv = _mm256_set1_epi32(static_cast<int>(off));
+    const __m256i diff = _mm256_set1_epi32(static_cast<int>(off ^ on));
+    for (int i = 0; i < 8; ++i) {
+        int byte = static_cast<int>((bits >> (56 - 8 * i)) & 0xFF);
+        __m256i lanes = _mm256_and_si256(_mm256_set1_epi32(byte), select);
+        __m256i mask = _mm256_cmpeq_epi32(lanes, select);
+        __m256i pixels = _mm256_xor_si256(offv, _mm256_and_si256(diff, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 8 * i), pixels);
+    }
+}
+#endif
+
+Chip8Expand::Kernel detectKernel() {
+#ifdef CHIP8_EXPAND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Chip8Expand::Kernel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return Chip8Expand::Kernel::SSE2;
+#endif
+    return Chip8Expand::Kernel::Scalar;
+}
+
+RowKernel rowKernel() {
+    static const RowKernel selected = [] {
+        switch (Chip8Expand::kernel()) {
+#ifdef CHIP8_EXPAND_X86
+            case Chip8Expand::Kernel::AVX2: return &expandAVX2;
+            case Chip8Expand::Kernel::SSE2: return &expandSSE2;
+#endif
+            default: return &expandScalar;
+        }
+    }();
+    return selected;
+}
+
+} // namespace
+
+Chip8Expand::Kernel Chip8Expand::kernel() {
+    static const Kernel detected = detectKernel();
+    return detected;
+}
+
+const char* Chip8Expand::kernelName() {
+    switch (kernel()) {
+        case Kernel::AVX2: return "AVX2";
+        case Kernel::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+void Chip8Expand::expandRow(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest) {
+    rowKernel()(bits, off, on, dest);
+}
+
+void Chip8Expand::expand(const uint64_t* rows, int count, uint32_t off, uint32_t on,
+                         uint32_t* dest, int pitch, int scale) {
+    if (scale < 1)
+        return;
+
+    RowKernel expandLine = rowKernel();
+    uint8_t* base = reinterpret_cast<uint8_t*>(dest);
+    uint32_t line[64];
+
+    for (int row = 0; row < count; ++row) {
+        uint32_t* out = reinterpret_cast<uint32_t*>(base + static_cast<ptrdiff_t>(row) * scale * pitch);
+        if (scale == 1) {
+            expandLine(rows[row], off, on, out);
+            continue;
+        }
+
+        // Widen each pixel, then repeat the line downwards
+        expandLine(rows[row], off, on, line);
+        for (int x = 0; x < 64; ++x)
+            std::fill_n(out + x * scale, scale, line[x]);
+        for (int i = 1; i < scale; ++i)
+            memcpy(base + (static_cast<ptrdiff_t>(row) * scale + i) * pitch, out, 64 * scale * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+// Expansion of the packed framebuffer into 32-bit pixels. Each source row
+// is a uint64_t with the leftmost pixel in the most significant bit and is
+// written through a two-entry palette, optionally scaled up by an integer
+// factor in both directions. The kernel is picked once from the host CPU:
+// AVX2 or SSE2 on x86, scalar everywhere else.
+class Chip8Expand {
+public:
+    enum class Kernel {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    static Kernel kernel();
+    static const char* kernelName();
+
+    // Expand `count` rows into `dest`, each pixel becoming a `scale` x
+    // `scale` block. `pitch` is the distance between output lines in bytes.
+    static void expand(const uint64_t* rows, int count, uint32_t off, uint32_t on,
+                       uint32_t* dest, int pitch, int scale = 1);
+
+    // Expand one row into 64 pixels
+    static void expandRow(uint64_t bits, uint32_t off, uint32_t on, uint32_t* dest);
+};
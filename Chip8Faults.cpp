@@ -0,0 +1,86 @@
+#include "Chip8Faults.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+Chip8Faults::Chip8Faults() : policy(Policy::Ignore), handler(nullptr), logLimit(8) {
+    clear();
+}
+
+void Chip8Faults::clear() {
+    logged = 0;
+    faults = 0;
+    opcodeCounts.clear();
+    firstFault = { 0, 0, 0 };
+    lastFault = firstFault;
+}
+
+uint64_t Chip8Faults::count(uint16_t opcode) const {
+    auto found = opcodeCounts.find(opcode);
+    return found != opcodeCounts.end() ? found->second : 0;
+}
+
+void Chip8Faults::writeSummary(FILE* out, size_t limit) const {
+    if (faults == 0)
+        return;
+
+    fprintf(out, "%llu unknown opcodes executed (%zu distinct), first 0x%04X at 0x%03X, instruction %llu\n",
+            static_cast<unsigned long long>(faults), opcodeCounts.size(), firstFault.opcode, firstFault.address,
+            static_cast<unsigned long long>(firstFault.cycle));
+
+    std::vector<std::pair<uint64_t, uint16_t>> ranked;
+    for (const auto& entry : opcodeCounts)
+        ranked.emplace_back(entry.second, entry.first);
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t i = 0; i < ranked.size() && i < limit; ++i)
+        fprintf(out, "  0x%04X  %llu\n", ranked[i].second, static_cast<unsigned long long>(ranked[i].first));
+}
+
+const char* Chip8Faults::policyName(Policy policy) {
+    switch (policy) {
+        case Policy::Ignore: return "ignore";
+        case Policy::Halt:   return "halt";
+        case Policy::Trap:   return "trap";
+    }
+    return "unknown";
+}
+
+bool Chip8Faults::parsePolicy(const char* name, Policy& out) {
+    for (Policy policy : { Policy::Ignore, Policy::Halt, Policy::Trap }) {
+        if (strcmp(name, policyName(policy)) == 0) {
+            out = policy;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Chip8Faults::record(Chip8& chip8, const Fault& fault) {
+    if (faults++ == 0)
+        firstFault = fault;
+    lastFault = fault;
+    if (opcodeCounts[fault.opcode]++ == 0)
+        log(fault);
+
+    switch (policy) {
+        case Policy::Ignore: return true;
+        case Policy::Halt:   return false;
+        case Policy::Trap:   return !handler || handler->unknownOpcode(chip8, fault.address, fault.opcode);
+    }
+    return true;
+}
+
+void Chip8Faults::log(const Fault& fault) {
+    if (logged > logLimit)
+        return;
+    if (logged++ == logLimit) {
+        if (logLimit > 0)
+            fprintf(stderr, "Further unknown opcodes are counted but not logged\n");
+        return;
+    }
+    fprintf(stderr, "Unknown opcode 0x%04X at 0x%03X, instruction %llu\n", fault.opcode, fault.address,
+            static_cast<unsigned long long>(fault.cycle));
+}
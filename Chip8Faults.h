@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+
+class Chip8;
+
+// Called by Chip8Faults under the Trap policy, before pc moves on
+class Chip8FaultHandler {
+public:
+    virtual ~Chip8FaultHandler() {}
+    // Return true to continue with the next instruction, false to halt on
+    // this one as the Halt policy would
+    virtual bool unknownOpcode(Chip8& chip8, uint16_t address, uint16_t opcode) = 0;
+};
+
+// Opcodes with no handler, counted per opcode, and what to do about them.
+// Every Chip8 owns one, see Chip8::getFaults(). Faults are rare and
+// recorded off the hot path; the interpreter loop pays nothing for them.
+//
+// Policies:
+//   Ignore  skip the instruction, as the original interpreter did
+//   Halt    leave pc on the instruction and stop the current run call
+//           with StopReason::UnknownOpcode. Running again executes (and
+//           counts) it again.
+//   Trap    ask the attached Chip8FaultHandler; Ignore without one
+//
+// The first occurrence of each distinct opcode is logged to stderr, up to
+// the log limit; after that a single line says the rest are not logged.
+class Chip8Faults {
+public:
+    enum class Policy {
+        Ignore,
+        Halt,
+        Trap,
+    };
+
+    struct Fault {
+        uint64_t cycle;         // Instruction count when it was executed
+        uint16_t address;
+        uint16_t opcode;
+    };
+
+    Chip8Faults();
+
+    void setPolicy(Policy newPolicy) { policy = newPolicy; }
+    Policy getPolicy() const { return policy; }
+    // Not owned; nullptr detaches
+    void setHandler(Chip8FaultHandler* newHandler) { handler = newHandler; }
+    void setLogLimit(int lines) { logLimit = lines; }  // 0 logs nothing
+
+    // Counters and the log budget start over; the policy, handler and log
+    // limit stay
+    void clear();
+
+    uint64_t total() const { return faults; }
+    uint64_t count(uint16_t opcode) const;
+    const std::map<uint16_t, uint64_t>& counts() const { return opcodeCounts; }  // By opcode
+    const Fault& first() const { return firstFault; }   // Valid if total() > 0
+    const Fault& last() const { return lastFault; }
+
+    // Totals, the first fault and the `limit` most frequent opcodes.
+    // Writes nothing if there were no faults.
+    void writeSummary(FILE* out, size_t limit = 8) const;
+
+    static const char* policyName(Policy policy);
+    static bool parsePolicy(const char* name, Policy& out);    // "ignore", "halt", "trap"
+
+    // Counts the fault and applies the policy. Returns true if execution
+    // continues past the instruction. Called by Chip8.
+    bool record(Chip8& chip8, const Fault& fault);
+
+private:
+    Policy policy;
+    Chip8FaultHandler* handler;
+    int logLimit;
+    int logged;
+
+    uint64_t faults;
+    std::map<uint16_t, uint64_t> opcodeCounts;
+    Fault firstFault;
+    Fault lastFault;
+
+    void log(const Fault& fault);
+};
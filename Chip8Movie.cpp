@@ -0,0 +1,217 @@
+#include "Chip8Movie.h"
+#include "Chip8.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const uint8_t magic[4] = { 'C', '8', 'M', 'V' };
+const size_t headerSize = 4 + 2 + 2 + 8 + 8 + 4 + 8 + 8 + 4;  // Version 2, version 3 adds 2
+
+template<typename T>
+void putLE(std::vector<uint8_t>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i)
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+}
+
+template<typename T>
+T getLE(const uint8_t*& in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<uint64_t>(*in++) << (8 * i);
+    return static_cast<T>(value);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+uint64_t Chip8Movie::hash(const uint8_t* data, size_t size) {
+    uint64_t value = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i) {
+        value ^= data[i];
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+uint64_t Chip8Movie::hashFile(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return 0;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return hash(data.data(), data.size());
+}
+
+uint64_t Chip8Movie::hashState(const Chip8& chip8) {
+    std::vector<uint8_t> saved = chip8.saveState();
+    return hash(saved.data(), saved.size());
+}
+
+void Chip8Movie::begin(Chip8& chip8, const char* romFile, uint64_t newSeed, uint32_t newCyclesPerTick,
+                       Chip8Timing::Model newTiming) {
+    romHash = hashFile(romFile);
+    seed = newSeed;
+    timing = newTiming;
+    cyclesPerTick = timing == Chip8Timing::Model::VIP ? Chip8Timing::cyclesPerTick : newCyclesPerTick;
+    quirks = chip8.getQuirks();
+    endCycle = 0;
+    endStateHash = 0;
+    events.clear();
+
+    chip8.seedRandom(seed);
+    chip8.setCyclesPerTimerTick(static_cast<int>(cyclesPerTick));
+}
+
+void Chip8Movie::setKey(Chip8& chip8, int key, bool pressed) {
+    if (key < 0 || key >= 16 || (chip8.getState().key[key] != 0) == pressed)
+        return;     // Only transitions matter
+    chip8.setKey(key, pressed);
+    events.push_back({ chip8.getCycleCount(), static_cast<uint8_t>(key), pressed });
+}
+
+void Chip8Movie::end(const Chip8& chip8) {
+    endCycle = chip8.getCycleCount();
+    endStateHash = hashState(chip8);
+}
+
+void Chip8Movie::truncate(uint64_t cycle) {
+    while (!events.empty() && events.back().cycle >= cycle)
+        events.pop_back();
+}
+
+uint64_t Chip8Movie::play(Chip8& chip8) const {
+    chip8.setQuirks(quirks);
+    chip8.seedRandom(seed);
+    chip8.setCyclesPerTimerTick(static_cast<int>(cyclesPerTick));
+
+    uint64_t start = chip8.getCycleCount();
+    if (timing == Chip8Timing::Model::VIP) {
+        // Keys change between frames, so every event falls on a frame boundary
+        Chip8Timing model;
+        for (const Event& event : events) {
+            while (chip8.getCycleCount() < event.cycle)
+                model.runFrame(chip8);
+            chip8.setKey(event.key, event.pressed);
+        }
+        while (chip8.getCycleCount() < endCycle)
+            model.runFrame(chip8);
+        return chip8.getCycleCount() - start;
+    }
+
+    // runCycles() stops exactly on its budget, fast-forwarded waits included
+    for (const Event& event : events) {
+        if (event.cycle > chip8.getCycleCount())
+            chip8.runCycles(event.cycle - chip8.getCycleCount());
+        chip8.setKey(event.key, event.pressed);
+    }
+    if (endCycle > chip8.getCycleCount())
+        chip8.runCycles(endCycle - chip8.getCycleCount());
+    return chip8.getCycleCount() - start;
+}
+
+std::vector<uint8_t> Chip8Movie::serialize() const {
+    std::vector<uint8_t> out;
+    out.reserve(headerSize + 2 + events.size() * 3);
+
+    for (uint8_t byte : magic)
+        out.push_back(byte);
+    putLE<uint16_t>(out, version);
+    putLE(out, static_cast<uint16_t>(quirks));
+    putLE(out, static_cast<uint16_t>(timing));
+    putLE(out, romHash);
+    putLE(out, seed);
+    putLE(out, cyclesPerTick);
+    putLE(out, endCycle);
+    putLE(out, endStateHash);
+    putLE(out, static_cast<uint32_t>(events.size()));
+
+    uint64_t previous = 0;
+    for (const Event& event : events) {
+        putVarint(out, event.cycle - previous);
+        out.push_back(static_cast<uint8_t>((event.key & 0xF) | (event.pressed ? 0x10 : 0)));
+        previous = event.cycle;
+    }
+    return out;
+}
+
+bool Chip8Movie::deserialize(const uint8_t* data, size_t size) {
+    if (!data || size < headerSize || memcmp(data, magic, sizeof(magic)) != 0)
+        return false;
+
+    const uint8_t* in = data + sizeof(magic);
+    const uint8_t* end = data + size;
+    uint16_t saved = getLE<uint16_t>(in);
+    uint16_t quirks = getLE<uint16_t>(in);
+    if (saved == 0 || saved > version || quirks >= Chip8Quirks::profileCount)
+        return false;
+    uint16_t timing = 0;
+    if (saved >= 3) {
+        if (size < headerSize + 2)
+            return false;
+        timing = getLE<uint16_t>(in);
+        if (timing >= Chip8Timing::modelCount)
+            return false;
+    }
+
+    Chip8Movie movie;
+    movie.quirks = static_cast<Chip8Quirks::Profile>(quirks);
+    movie.timing = static_cast<Chip8Timing::Model>(timing);
+    movie.romHash = getLE<uint64_t>(in);
+    movie.seed = getLE<uint64_t>(in);
+    movie.cyclesPerTick = getLE<uint32_t>(in);
+    movie.endCycle = getLE<uint64_t>(in);
+    movie.endStateHash = getLE<uint64_t>(in);
+    uint32_t count = getLE<uint32_t>(in);
+    if (movie.cyclesPerTick == 0 || count > size)   // Every event takes at least two bytes
+        return false;
+
+    movie.events.reserve(count);
+    uint64_t cycle = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t delta;
+        if (!getVarint(in, end, delta) || in >= end)
+            return false;
+        cycle += delta;
+        uint8_t packed = *in++;
+        movie.events.push_back({ cycle, static_cast<uint8_t>(packed & 0xF), (packed & 0x10) != 0 });
+    }
+
+    *this = movie;
+    return true;
+}
+
+bool Chip8Movie::save(const char* filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::vector<uint8_t> data = serialize();
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+bool Chip8Movie::load(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return deserialize(data.data(), data.size());
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Chip8Quirks.h"
+#include "Chip8Timing.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Chip8;
+
+// Input recording of one session from power-on: the ROM hash, CXNN seed,
+// timer rate, quirk profile and timing model it started with, then every
+// key transition stamped with the instruction count it happened at. Nothing
+// else feeds the machine, so playing a movie back reproduces the session
+// bit for bit, at any speed.
+//
+// Binary layout, all integers little endian:
+//   "C8MV"  magic
+//   u16     format version
+//   u16     Chip8Quirks profile (version 2, 0 = default in version 1)
+//   u16     Chip8Timing model (version 3 only, instructions before)
+//   u64     FNV-1a hash of the ROM file
+//   u64     seed
+//   u32     cycles per timer tick
+//   u64     instruction count at the end of the recording
+//   u64     FNV-1a hash of the final state as saved by Chip8SaveState
+//   u32     number of events
+//   events  varint instructions since the previous event, then one byte:
+//           key in bits 0-3, bit 4 set for a press
+class Chip8Movie {
+public:
+    static constexpr uint16_t version = 3;
+
+    struct Event {
+        uint64_t cycle;
+        uint8_t key;
+        bool pressed;
+    };
+
+    uint64_t romHash = 0;
+    uint64_t seed = 0;
+    uint32_t cyclesPerTick = 10;
+    Chip8Quirks::Profile quirks = Chip8Quirks::Profile::Default;
+    Chip8Timing::Model timing = Chip8Timing::Model::Instructions;
+    uint64_t endCycle = 0;
+    uint64_t endStateHash = 0;
+    std::vector<Event> events;
+
+    static uint64_t hash(const uint8_t* data, size_t size);
+    static uint64_t hashFile(const char* filename);    // 0 if unreadable
+    static uint64_t hashState(const Chip8& chip8);
+
+    // Recording. begin() is called on a machine that has its ROM loaded and
+    // has not run yet, seeds its generator and keeps its quirk profile.
+    // Under the VIP timing model the timer rate is Chip8Timing's and every
+    // frame must be run with Chip8Timing::runFrame(). setKey() forwards to
+    // the machine and logs the change; end() stamps the final state.
+    void begin(Chip8& chip8, const char* romFile, uint64_t seed, uint32_t cyclesPerTick,
+               Chip8Timing::Model timing = Chip8Timing::Model::Instructions);
+    void setKey(Chip8& chip8, int key, bool pressed);
+    void end(const Chip8& chip8);
+
+    // Forget events from `cycle` on, after the machine was rewound to it
+    void truncate(uint64_t cycle);
+
+    // Run a freshly loaded machine through the whole recording as fast as
+    // possible. Returns the instructions executed.
+    uint64_t play(Chip8& chip8) const;
+
+    std::vector<uint8_t> serialize() const;
+    bool deserialize(const uint8_t* data, size_t size);
+    bool save(const char* filename) const;
+    bool load(const char* filename);
+};
@@ -0,0 +1,23 @@
+#include "Chip8Pool.h"
+#include "Chip8.h"
+
+Chip8Pool::Chip8Pool(size_t capacity) : states(capacity) {
+    freeSlots.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i)
+        freeSlots.push_back(static_cast<uint32_t>(i - 1));
+}
+
+Chip8State* Chip8Pool::acquire() {
+    if (freeSlots.empty())
+        return nullptr;
+
+    Chip8State* state = &states[freeSlots.back()];
+    freeSlots.pop_back();
+    Chip8::resetState(*state);
+    return state;
+}
+
+void Chip8Pool::release(Chip8State* state) {
+    if (state)
+        freeSlots.push_back(static_cast<uint32_t>(indexOf(state)));
+}
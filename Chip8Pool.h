@@ -0,0 +1,31 @@
+#pragma once
+#include "Chip8State.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity arena of machine states in one contiguous, cache-line
+// aligned allocation. States never move while the pool is alive, so a
+// Chip8 can stay attached to one, and a single Chip8 can run many of them
+// in turn with Chip8::attach().
+class Chip8Pool {
+public:
+    explicit Chip8Pool(size_t capacity);
+
+    Chip8Pool(const Chip8Pool&) = delete;
+    Chip8Pool& operator=(const Chip8Pool&) = delete;
+
+    // Hand out a state in power-on condition, nullptr when the pool is full
+    Chip8State* acquire();
+    void release(Chip8State* state);
+
+    size_t capacity() const { return states.size(); }
+    size_t inUse() const { return states.size() - freeSlots.size(); }
+
+    Chip8State& operator[](size_t index) { return states[index]; }
+    size_t indexOf(const Chip8State* state) const { return static_cast<size_t>(state - states.data()); }
+
+private:
+    std::vector<Chip8State> states;
+    std::vector<uint32_t> freeSlots;    // Popped from the back, lowest index first
+};
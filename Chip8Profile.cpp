@@ -0,0 +1,142 @@
+#include "Chip8Profile.h"
+#include <algorithm>
+
+Chip8Profile::Chip8Profile(uint32_t sampleInterval)
+    : sampleInterval(sampleInterval), clockOverhead(0.0) {
+    clear();
+
+    // Cost of the two clock reads around a sampled instruction
+    const int reads = 1000;
+    Clock::duration total = Clock::duration::zero();
+    for (int i = 0; i < reads; ++i) {
+        Clock::time_point start = Clock::now();
+        total += Clock::now() - start;
+    }
+    clockOverhead = std::chrono::duration<double, std::nano>(total).count() / reads;
+}
+
+void Chip8Profile::clear() {
+    untilSample = sampleInterval;
+    opcodeCounts.assign(65536, 0);
+    addressCounts.assign(4096, 0);
+    addressOpcodes.assign(4096, 0);
+    std::fill(std::begin(samples), std::end(samples), 0);
+    std::fill(std::begin(sampledNanoseconds), std::end(sampledNanoseconds), 0.0);
+}
+
+void Chip8Profile::addSample(uint16_t opcode, Clock::duration elapsed) {
+    int family = Chip8::opcodeFamily(opcode);
+    double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() - clockOverhead;
+    ++samples[family];
+    sampledNanoseconds[family] += std::max(nanoseconds, 0.0);
+}
+
+uint64_t Chip8Profile::instructions() const {
+    uint64_t total = 0;
+    for (uint64_t count : addressCounts)
+        total += count;
+    return total;
+}
+
+uint64_t Chip8Profile::familyCount(int family) const {
+    uint64_t total = 0;
+    for (uint32_t opcode = 0; opcode < 65536; ++opcode) {
+        if (Chip8::opcodeFamily(static_cast<uint16_t>(opcode)) == family)
+            total += opcodeCounts[opcode];
+    }
+    return total;
+}
+
+double Chip8Profile::familyNanoseconds(int family) const {
+    return samples[family] ? sampledNanoseconds[family] / samples[family] : -1.0;
+}
+
+std::vector<uint16_t> Chip8Profile::hotAddresses() const {
+    std::vector<uint16_t> addresses;
+    for (uint16_t address = 0; address < 4096; ++address) {
+        if (addressCounts[address])
+            addresses.push_back(address);
+    }
+    std::stable_sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+        return addressCounts[a] > addressCounts[b];
+    });
+    return addresses;
+}
+
+void Chip8Profile::writeJson(FILE* out) const {
+    uint64_t total = instructions();
+    fprintf(out, "{\n  \"instructions\": %llu,\n  \"sample_interval\": %u,\n  \"families\": [",
+            static_cast<unsigned long long>(total), sampleInterval);
+    bool first = true;
+    for (int family = 0; family < Chip8::opcodeFamilyCount; ++family) {
+        uint64_t count = familyCount(family);
+        if (!count)
+            continue;
+        fprintf(out, "%s\n    { \"name\": \"%s\", \"count\": %llu, \"samples\": %llu, \"ns\": %.2f }",
+                first ? "" : ",", Chip8::opcodeFamilyName(family), static_cast<unsigned long long>(count),
+                static_cast<unsigned long long>(samples[family]), familyNanoseconds(family));
+        first = false;
+    }
+
+    fprintf(out, "\n  ],\n  \"opcodes\": [");
+    first = true;
+    for (uint32_t opcode = 0; opcode < 65536; ++opcode) {
+        if (!opcodeCounts[opcode])
+            continue;
+        fprintf(out, "%s\n    { \"opcode\": \"%04X\", \"count\": %llu }", first ? "" : ",", opcode,
+                static_cast<unsigned long long>(opcodeCounts[opcode]));
+        first = false;
+    }
+
+    fprintf(out, "\n  ],\n  \"addresses\": [");
+    first = true;
+    for (uint16_t address : hotAddresses()) {
+        fprintf(out, "%s\n    { \"address\": \"%03X\", \"opcode\": \"%04X\", \"count\": %llu }",
+                first ? "" : ",", address, addressOpcodes[address],
+                static_cast<unsigned long long>(addressCounts[address]));
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+void Chip8Profile::writeCsv(FILE* out) const {
+    fprintf(out, "kind,key,name,count,ns\n");
+    for (int family = 0; family < Chip8::opcodeFamilyCount; ++family) {
+        uint64_t count = familyCount(family);
+        if (count)
+            fprintf(out, "family,%d,%s,%llu,%.2f\n", family, Chip8::opcodeFamilyName(family),
+                    static_cast<unsigned long long>(count), familyNanoseconds(family));
+    }
+    for (uint32_t opcode = 0; opcode < 65536; ++opcode) {
+        if (opcodeCounts[opcode])
+            fprintf(out, "opcode,%04X,%s,%llu,\n", opcode,
+                    Chip8::opcodeFamilyName(Chip8::opcodeFamily(static_cast<uint16_t>(opcode))),
+                    static_cast<unsigned long long>(opcodeCounts[opcode]));
+    }
+    for (uint16_t address = 0; address < 4096; ++address) {
+        if (addressCounts[address])
+            fprintf(out, "address,%03X,%04X,%llu,\n", address, addressOpcodes[address],
+                    static_cast<unsigned long long>(addressCounts[address]));
+    }
+}
+
+void Chip8Profile::writeHotSpots(FILE* out, size_t limit) const {
+    uint64_t total = instructions();
+    if (!total) {
+        fprintf(out, "No instructions profiled\n");
+        return;
+    }
+
+    fprintf(out, "%-7s %-6s %-8s %14s %7s %7s\n", "address", "opcode", "family", "count", "%", "cum %");
+    std::vector<uint16_t> addresses = hotAddresses();
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < addresses.size() && i < limit; ++i) {
+        uint16_t address = addresses[i];
+        uint16_t opcode = addressOpcodes[address];
+        cumulative += addressCounts[address];
+        fprintf(out, "0x%03X   %04X   %-8s %14llu %6.2f%% %6.2f%%\n", address, opcode,
+                Chip8::opcodeFamilyName(Chip8::opcodeFamily(opcode)),
+                static_cast<unsigned long long>(addressCounts[address]),
+                100.0 * addressCounts[address] / total, 100.0 * cumulative / total);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Chip8.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Execution profile of one machine: how often every exact opcode and every
+// address was executed, and sampled wall time per instruction family.
+// Attach it with Chip8::setProfile() in a build with CHIP8_PROFILE defined.
+//
+// Timing is sampled: every `sampleInterval` instructions one is executed
+// under the clock and its time, minus the measured cost of reading the
+// clock, is charged to its family. Busy waits that the run calls
+// fast-forward are not executed, so they are not counted either.
+class Chip8Profile {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Chip8Profile(uint32_t sampleInterval = 997);  // 0 = no timing
+
+    void clear();
+
+    // Called by the interpreter for every instruction. Returns true when
+    // this one should be timed and reported through addSample().
+    bool count(uint16_t address, uint16_t opcode) {
+        ++addressCounts[address];
+        addressOpcodes[address] = opcode;
+        ++opcodeCounts[opcode];
+        if (sampleInterval == 0 || --untilSample != 0)
+            return false;
+        untilSample = sampleInterval;
+        return true;
+    }
+    void addSample(uint16_t opcode, Clock::duration elapsed);
+
+    uint64_t instructions() const;
+    uint64_t opcodeCount(uint16_t opcode) const { return opcodeCounts[opcode]; }
+    uint64_t addressCount(uint16_t address) const { return addressCounts[address & 0x0FFF]; }
+    uint64_t familyCount(int family) const;
+    uint64_t familySamples(int family) const { return samples[family]; }
+    double familyNanoseconds(int family) const;     // Mean sampled time, -1 without samples
+
+    // Reports. JSON has everything; CSV has one "kind,key,name,count,ns"
+    // row per family, opcode and address executed; hot spots is a flat
+    // listing of the `limit` most executed addresses, busiest first.
+    void writeJson(FILE* out) const;
+    void writeCsv(FILE* out) const;
+    void writeHotSpots(FILE* out, size_t limit = 30) const;
+
+private:
+    uint32_t sampleInterval;
+    uint32_t untilSample;
+    double clockOverhead;           // Nanoseconds, subtracted from every sample
+
+    std::vector<uint64_t> opcodeCounts;             // 65536 entries
+    std::vector<uint64_t> addressCounts;            // 4096 entries
+    std::vector<uint16_t> addressOpcodes;           // Last opcode run at each address
+    uint64_t samples[Chip8::opcodeFamilyCount];
+    double sampledNanoseconds[Chip8::opcodeFamilyCount];
+
+    // Executed addresses, most executed first
+    std::vector<uint16_t> hotAddresses() const;
+};
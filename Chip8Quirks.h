@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Interpretations of the opcodes that CHIP-8 implementations disagree on.
+// Each profile is a policy type of constexpr flags, Chip8Quirks::Set<P>,
+// and the interpreter instantiates every quirk-dependent handler once per
+// profile, so a handler never tests a quirk at runtime. Chip8::setQuirks()
+// picks the instantiation; it is resolved when an opcode is decoded.
+//
+//                      shift    FX55/FX65  BNNN   DXYN at   8XY1-3
+//                      source   I after    adds   the edge  VF
+//   Default            VX       unchanged  V0     wraps     kept
+//   VIP (COSMAC VIP)   VY       I + X + 1  V0     clips     reset
+//   CHIP48             VX       I + X      VX     clips     kept
+//   SuperChip          VX       unchanged  VX     clips     kept
+//   XOChip             VY       I + X + 1  V0     wraps     kept
+//
+// Default is the original behaviour of this interpreter, which Chip8Aot
+// and chip8_recompile implement as well. Only the differences of the base
+// instruction set are modelled, not the extended instructions of
+// SUPER-CHIP or XO-CHIP.
+class Chip8Quirks {
+public:
+    enum class Profile : uint16_t {
+        Default,
+        VIP,
+        CHIP48,
+        SuperChip,
+        XOChip,
+    };
+    static constexpr int profileCount = 5;
+
+    // What FX55 and FX65 leave in I
+    enum class Index {
+        Unchanged,
+        AddX,
+        AddXPlusOne,
+    };
+
+    template<Profile P>
+    struct Set;
+
+    static const char* name(Profile profile) {
+        static const char* const names[profileCount] = { "default", "vip", "chip48", "schip", "xochip" };
+        return names[static_cast<int>(profile)];
+    }
+
+    static bool parse(const char* text, Profile& out) {
+        for (int p = 0; p < profileCount; ++p) {
+            if (strcmp(text, name(static_cast<Profile>(p))) == 0) {
+                out = static_cast<Profile>(p);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template<>
+struct Chip8Quirks::Set<Chip8Quirks::Profile::Default> {
+    static constexpr bool shiftUsesVY = false;
+    static constexpr Index index = Index::Unchanged;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool clipSprites = false;
+    static constexpr bool logicResetsVF = false;
+};
+
+template<>
+struct Chip8Quirks::Set<Chip8Quirks::Profile::VIP> {
+    static constexpr bool shiftUsesVY = true;
+    static constexpr Index index = Index::AddXPlusOne;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool clipSprites = true;
+    static constexpr bool logicResetsVF = true;
+};
+
+template<>
+struct Chip8Quirks::Set<Chip8Quirks::Profile::CHIP48> {
+    static constexpr bool shiftUsesVY = false;
+    static constexpr Index index = Index::AddX;
+    static constexpr bool jumpUsesVX = true;
+    static constexpr bool clipSprites = true;
+    static constexpr bool logicResetsVF = false;
+};
+
+template<>
+struct Chip8Quirks::Set<Chip8Quirks::Profile::SuperChip> {
+    static constexpr bool shiftUsesVY = false;
+    static constexpr Index index = Index::Unchanged;
+    static constexpr bool jumpUsesVX = true;
+    static constexpr bool clipSprites = true;
+    static constexpr bool logicResetsVF = false;
+};
+
+template<>
+struct Chip8Quirks::Set<Chip8Quirks::Profile::XOChip> {
+    static constexpr bool shiftUsesVY = true;
+    static constexpr Index index = Index::AddXPlusOne;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool clipSprites = false;
+    static constexpr bool logicResetsVF = false;
+};
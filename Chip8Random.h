@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+
+// Random source for CXNN. Chip8 uses its built-in Chip8Random unless a
+// source is attached with Chip8::setRandomSource().
+class Chip8RandomSource {
+public:
+    virtual ~Chip8RandomSource() {}
+    virtual uint8_t nextByte() = 0;
+};
+
+// xoshiro128** generator. The whole state is four words, so it is cheap to
+// copy and save alongside the rest of the machine. Trivial on purpose:
+// call reseed() before first use.
+class Chip8Random {
+public:
+    struct State {
+        uint32_t s[4];
+    };
+
+    // Expand a 64-bit seed into the state with splitmix64
+    void reseed(uint64_t seed) {
+        for (int i = 0; i < 4; i += 2) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            state.s[i] = static_cast<uint32_t>(z);
+            state.s[i + 1] = static_cast<uint32_t>(z >> 32);
+        }
+    }
+
+    uint32_t next() {
+        uint32_t* s = state.s;
+        uint32_t result = rotl(s[1] * 5, 7) * 9;
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+
+    uint8_t nextByte() { return static_cast<uint8_t>(next() >> 24); }
+
+    const State& getState() const { return state; }
+    void setState(const State& newState) { state = newState; }
+
+private:
+    State state;
+
+    static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+};
@@ -0,0 +1,138 @@
+#include "Chip8Rewind.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void putVarint(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t getVarint(const uint8_t*& in) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+uint64_t loadWord(const uint8_t* bytes, size_t index) {
+    uint64_t word;
+    memcpy(&word, bytes + index * sizeof(word), sizeof(word));
+    return word;
+}
+
+} // namespace
+
+Chip8Rewind::Chip8Rewind(size_t budgetBytes)
+    : haveLatest(false), ring(std::max<size_t>(budgetBytes, 64 * 1024)), head(0), used(0) {
+    scratch.reserve(2 * sizeof(Chip8State));
+}
+
+void Chip8Rewind::clear() {
+    haveLatest = false;
+    entries.clear();
+    head = 0;
+    used = 0;
+}
+
+void Chip8Rewind::capture(const Chip8State& state) {
+    if (!haveLatest) {
+        memcpy(&latest, &state, sizeof(Chip8State));
+        haveLatest = true;
+        return;
+    }
+
+    encode(state, latest, scratch);
+    size_t offset = allocate(scratch.size());
+    memcpy(ring.data() + offset, scratch.data(), scratch.size());
+    memcpy(&latest, &state, sizeof(Chip8State));
+}
+
+bool Chip8Rewind::rewind(Chip8State& state) {
+    if (entries.empty())
+        return false;
+
+    Entry newest = entries.back();
+    entries.pop_back();
+    apply(ring.data() + newest.offset, newest.size, latest);
+    head = entries.empty() ? 0 : newest.offset;
+    used -= newest.size;
+
+    memcpy(&state, &latest, sizeof(Chip8State));
+    return true;
+}
+
+// Delta of two states: runs of (unchanged words, changed words, the XOR of
+// each changed word). Unchanged words at the end need no run.
+void Chip8Rewind::encode(const Chip8State& from, const Chip8State& to, std::vector<uint8_t>& out) {
+    const uint8_t* a = reinterpret_cast<const uint8_t*>(&from);
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(&to);
+    out.clear();
+
+    size_t i = 0;
+    while (i < words) {
+        size_t start = i;
+        while (i < words && loadWord(a, i) == loadWord(b, i))
+            ++i;
+        if (i == words)
+            break;
+
+        size_t zeros = i - start;
+        start = i;
+        while (i < words && loadWord(a, i) != loadWord(b, i))
+            ++i;
+
+        putVarint(out, zeros);
+        putVarint(out, i - start);
+        for (size_t w = start; w < i; ++w) {
+            uint64_t diff = loadWord(a, w) ^ loadWord(b, w);
+            uint8_t bytes[sizeof(diff)];
+            memcpy(bytes, &diff, sizeof(diff));
+            out.insert(out.end(), bytes, bytes + sizeof(bytes));
+        }
+    }
+}
+
+void Chip8Rewind::apply(const uint8_t* delta, size_t size, Chip8State& state) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&state);
+    const uint8_t* end = delta + size;
+    size_t w = 0;
+    while (delta < end) {
+        w += getVarint(delta);
+        size_t count = getVarint(delta);
+        for (; count > 0; --count, ++w, delta += sizeof(uint64_t)) {
+            uint64_t word = loadWord(bytes, w) ^ loadWord(delta, 0);
+            memcpy(bytes + w * sizeof(word), &word, sizeof(word));
+        }
+    }
+}
+
+// Entries from `head` onwards are always older than the ones before it,
+// so making room only ever drops the oldest
+size_t Chip8Rewind::allocate(size_t size) {
+    if (head + size > ring.size()) {
+        while (!entries.empty() && entries.front().offset >= head)
+            dropOldest();
+        head = 0;
+    }
+    while (!entries.empty() && entries.front().offset >= head && entries.front().offset < head + size)
+        dropOldest();
+
+    size_t offset = head;
+    entries.push_back({ offset, size });
+    head += size;
+    used += size;
+    return offset;
+}
+
+void Chip8Rewind::dropOldest() {
+    used -= entries.front().size;
+    entries.pop_front();
+}
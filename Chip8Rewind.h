@@ -0,0 +1,57 @@
+#pragma once
+#include "Chip8State.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Rewind history of machine states in a fixed memory budget. Only the
+// newest state is kept whole. Each capture stores the XOR of the new state
+// with the previous one, run-length encoded in 64-bit words. A frame
+// usually changes a handful of words, so a delta is a few dozen bytes.
+// XOR is its own inverse, so applying the newest delta to the newest state
+// gives back the one before it. The deltas live in one ring buffer and
+// the oldest are dropped when it fills up.
+class Chip8Rewind {
+public:
+    explicit Chip8Rewind(size_t budgetBytes = 4 * 1024 * 1024);
+
+    Chip8Rewind(const Chip8Rewind&) = delete;
+    Chip8Rewind& operator=(const Chip8Rewind&) = delete;
+
+    // Record the state of the frame that just ran
+    void capture(const Chip8State& state);
+
+    // Step back one capture: `state` becomes the capture before the newest,
+    // which is dropped. False when there is nothing older to go back to.
+    bool rewind(Chip8State& state);
+
+    void clear();
+
+    size_t frames() const { return entries.size(); }    // Captures that can be rewound
+    size_t bytesUsed() const { return used; }
+
+private:
+    static constexpr size_t words = sizeof(Chip8State) / sizeof(uint64_t);
+    static_assert(sizeof(Chip8State) % sizeof(uint64_t) == 0, "Chip8State must be whole words");
+
+    struct Entry {
+        size_t offset;
+        size_t size;
+    };
+
+    Chip8State latest;          // Newest capture, whole
+    bool haveLatest;
+
+    std::vector<uint8_t> ring;  // Encoded deltas
+    std::deque<Entry> entries;  // Oldest first
+    size_t head;                // Where the next delta goes
+    size_t used;
+
+    std::vector<uint8_t> scratch;
+
+    static void encode(const Chip8State& from, const Chip8State& to, std::vector<uint8_t>& out);
+    static void apply(const uint8_t* delta, size_t size, Chip8State& state);
+    size_t allocate(size_t size);
+    void dropOldest();
+};
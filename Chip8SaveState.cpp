@@ -0,0 +1,134 @@
+#include "Chip8SaveState.h"
+#include <cstring>
+
+namespace {
+
+const uint8_t magic[4] = { 'C', '8', 'S', 'V' };
+
+// Payload size of each version, indexed by version
+const size_t payloadSize[] = {
+    0,
+    16 + 2 + 2 + 1 + 16 * 2 + 8 + 4 + 1 + 1 + 8 + 8 + 16 + 1 + 4 * 4 + 32 * 8 + 4096,
+};
+
+class Writer {
+public:
+    explicit Writer(std::vector<uint8_t>& out) : out(out) {}
+
+    void bytes(const uint8_t* data, size_t size) { out.insert(out.end(), data, data + size); }
+
+    template<typename T>
+    void le(T value) {
+        for (size_t i = 0; i < sizeof(T); ++i)
+            out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+    }
+
+private:
+    std::vector<uint8_t>& out;
+};
+
+class Reader {
+public:
+    explicit Reader(const uint8_t* data) : data(data) {}
+
+    void bytes(uint8_t* dest, size_t size) {
+        memcpy(dest, data, size);
+        data += size;
+    }
+
+    template<typename T>
+    T le() {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value |= static_cast<uint64_t>(*data++) << (8 * i);
+        return static_cast<T>(value);
+    }
+
+private:
+    const uint8_t* data;
+};
+
+} // namespace
+
+std::vector<uint8_t> Chip8SaveState::serialize(const Chip8State& state) {
+    std::vector<uint8_t> out;
+    out.reserve(headerSize + payloadSize[version]);
+    Writer w(out);
+
+    w.bytes(magic, sizeof(magic));
+    w.le<uint16_t>(version);
+    w.le<uint16_t>(0);
+    w.le<uint32_t>(static_cast<uint32_t>(payloadSize[version]));
+
+    w.bytes(state.V, sizeof(state.V));
+    w.le(state.I);
+    w.le(state.pc);
+    w.le(state.sp);
+    for (uint16_t entry : state.stack)
+        w.le(entry);
+
+    w.le(state.cycleCount);
+    w.le(state.cyclesPerTick);
+    w.le(state.delayValue);
+    w.le(state.soundValue);
+    w.le(state.delayTick);
+    w.le(state.soundTick);
+
+    w.bytes(state.key, sizeof(state.key));
+    w.le<uint8_t>(state.waitingForKey ? 1 : 0);
+    for (uint32_t word : state.rng.getState().s)
+        w.le(word);
+
+    for (uint64_t row : state.gfx)
+        w.le(row);
+    w.bytes(state.memory, sizeof(state.memory));
+    return out;
+}
+
+bool Chip8SaveState::deserialize(const uint8_t* data, size_t size, Chip8State& state) {
+    if (!data || size < headerSize || memcmp(data, magic, sizeof(magic)) != 0)
+        return false;
+
+    Reader header(data + sizeof(magic));
+    uint16_t saved = header.le<uint16_t>();
+    header.le<uint16_t>();
+    uint32_t payload = header.le<uint32_t>();
+    if (saved == 0 || saved > version || payload != payloadSize[saved] || size - headerSize < payload)
+        return false;
+
+    Chip8State loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    Reader r(data + headerSize);
+
+    r.bytes(loaded.V, sizeof(loaded.V));
+    loaded.I = r.le<uint16_t>();
+    loaded.pc = r.le<uint16_t>();
+    loaded.sp = r.le<uint8_t>();
+    for (uint16_t& entry : loaded.stack)
+        entry = r.le<uint16_t>();
+
+    loaded.cycleCount = r.le<uint64_t>();
+    loaded.cyclesPerTick = r.le<uint32_t>();
+    loaded.delayValue = r.le<uint8_t>();
+    loaded.soundValue = r.le<uint8_t>();
+    loaded.delayTick = r.le<uint64_t>();
+    loaded.soundTick = r.le<uint64_t>();
+
+    r.bytes(loaded.key, sizeof(loaded.key));
+    loaded.waitingForKey = r.le<uint8_t>() != 0;
+    Chip8Random::State rng;
+    for (uint32_t& word : rng.s)
+        word = r.le<uint32_t>();
+    loaded.rng.setState(rng);
+
+    for (uint64_t& row : loaded.gfx)
+        row = r.le<uint64_t>();
+    r.bytes(loaded.memory, sizeof(loaded.memory));
+
+    // The timers divide by this
+    if (loaded.cyclesPerTick == 0)
+        return false;
+
+    state = loaded;
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "Chip8State.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Versioned binary save format for a Chip8State. Unlike a raw copy of the
+// struct it does not depend on padding, alignment or byte order, so saves
+// can be exchanged between builds and machines.
+//
+// Layout, all integers little endian:
+//   "C8SV"  magic
+//   u16     format version
+//   u16     reserved, 0
+//   u32     payload size in bytes
+//   payload, in Chip8State field order: V[16], I, pc, sp, stack[16],
+//   cycleCount, cyclesPerTick, delayValue, soundValue, delayTick,
+//   soundTick, key[16], waitingForKey, rng (4 x u32), gfx (32 x u64),
+//   memory[4096]
+//
+// New fields are appended to the payload under a new version; readers
+// accept every version up to their own.
+class Chip8SaveState {
+public:
+    static constexpr uint16_t version = 1;
+    static constexpr size_t headerSize = 12;
+
+    static std::vector<uint8_t> serialize(const Chip8State& state);
+
+    // Fills `state` and returns true if `data` holds a complete save of a
+    // supported version; `state` is left untouched otherwise
+    static bool deserialize(const uint8_t* data, size_t size, Chip8State& state);
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "Chip8Random.h"
+#include <cstdint>
+#include <type_traits>
+
+// Everything the emulated machine needs to resume, in one block with no
+// pointers: it can be copied with memcpy, kept in a Chip8Pool or written
+// out as is. Host-side data derived from it (decoded instructions, the
+// 32-bit display, translated code) lives in the Chip8 it is attached to.
+// Registers and timers come first so a running machine touches one cache
+// line besides the memory it reads.
+struct alignas(64) Chip8State {
+    // CPU registers
+    uint8_t V[16];              // 16 8-bit registers V0-VF
+    uint16_t I;                 // Index register
+    uint16_t pc;                // Program counter
+    uint8_t sp;                 // Stack pointer
+    uint16_t stack[16];         // Stack
+
+    // Timers, evaluated lazily from the cycle counter. Each holds the value
+    // last written and the timer tick it was written on.
+    uint64_t cycleCount;        // Instructions executed since reset
+    uint32_t cyclesPerTick;     // Instructions per 60 Hz timer tick
+    uint8_t delayValue;
+    uint8_t soundValue;
+    uint64_t delayTick;
+    uint64_t soundTick;
+
+    // Input
+    uint8_t key[16];            // Keypad state
+    bool waitingForKey;         // Set while FX0A blocks on the keypad
+
+    Chip8Random rng;            // CXNN generator
+
+    // Memory and graphics
+    uint64_t gfx[32];           // Graphics buffer, one row per word, MSB = x 0
+    uint8_t memory[4096];       // 4K memory
+};
+
+static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State must stay trivially copyable");
+static_assert(std::is_standard_layout<Chip8State>::value, "Chip8State must stay standard layout");
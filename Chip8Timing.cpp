@@ -0,0 +1,117 @@
+#include "Chip8Timing.h"
+
+// Execution costs in machine cycles, not counting the fetch. Taken from the
+// timings of the VIP interpreter's routines, rounded.
+namespace {
+    const uint32_t clearCost = 24;              // 00E0
+    const uint32_t returnCost = 23;             // 00EE
+    const uint32_t jumpCost = 23;               // 1NNN, 2NNN, BNNN
+    const uint32_t skipImmediateCost = 12;      // 3XNN, 4XNN
+    const uint32_t skipRegisterCost = 16;       // 5XY0, 9XY0, EX9E, EXA1
+    const uint32_t loadImmediateCost = 6;       // 6XNN
+    const uint32_t addImmediateCost = 10;       // 7XNN
+    const uint32_t arithmeticCost = 44;         // 8XYN
+    const uint32_t loadIndexCost = 12;          // ANNN
+    const uint32_t randomCost = 36;             // CXNN
+    const uint32_t timerCost = 10;              // FX07, FX0A, FX15, FX18
+    const uint32_t addIndexCost = 19;           // FX1E
+    const uint32_t fontCost = 20;               // FX29
+    const uint32_t bcdCost = 36;                // FX33, plus bcdDigitCost per unit
+    const uint32_t bcdDigitCost = 8;
+    const uint32_t registerCopyCost = 12;       // FX55, FX65, plus copyCost per register
+    const uint32_t copyCost = 14;
+
+    // DXYN: setup, then per row a byte copy and, off byte alignment, a
+    // shift loop over the row's two bytes
+    const uint32_t spriteCost = 26;
+    const uint32_t rowCost = 12;
+    const uint32_t unalignedRowCost = 8;
+    const uint32_t shiftCost = 4;
+
+    // Cycles the interpreter gets per frame
+    const int64_t frameBudget = Chip8Timing::frameCycles - Chip8Timing::displayCycles;
+}
+
+uint32_t Chip8Timing::cost(const Chip8State& state, uint16_t opcode) {
+    uint8_t x = (opcode >> 8) & 0x0F;
+    uint32_t execute = minimumCost - fetchCycles;   // Unknown opcodes
+
+    switch (opcode >> 12) {
+        case 0x0:
+            if (opcode == 0x00E0)
+                execute = clearCost;
+            else if (opcode == 0x00EE)
+                execute = returnCost;
+            break;
+        case 0x1: case 0x2: case 0xB:
+            execute = jumpCost;
+            break;
+        case 0x3: case 0x4:
+            execute = skipImmediateCost;
+            break;
+        case 0x5: case 0x9: case 0xE:
+            execute = skipRegisterCost;
+            break;
+        case 0x6:
+            execute = loadImmediateCost;
+            break;
+        case 0x7:
+            execute = addImmediateCost;
+            break;
+        case 0x8:
+            execute = arithmeticCost;
+            break;
+        case 0xA:
+            execute = loadIndexCost;
+            break;
+        case 0xC:
+            execute = randomCost;
+            break;
+        case 0xD: {
+            uint32_t rows = opcode & 0x0F;
+            uint32_t shift = state.V[x] & 7;
+            execute = spriteCost + rows * (rowCost + (shift ? unalignedRowCost + shiftCost * shift : 0));
+            break;
+        }
+        case 0xF:
+            switch (opcode & 0xFF) {
+                case 0x07: case 0x0A: case 0x15: case 0x18:
+                    execute = timerCost;
+                    break;
+                case 0x1E:
+                    execute = addIndexCost;
+                    break;
+                case 0x29:
+                    execute = fontCost;
+                    break;
+                case 0x33: {
+                    // Each decimal digit is found by repeated subtraction
+                    uint8_t value = state.V[x];
+                    execute = bcdCost + bcdDigitCost * (value / 100 + value / 10 % 10 + value % 10);
+                    break;
+                }
+                case 0x55: case 0x65:
+                    execute = registerCopyCost + copyCost * (x + 1u);
+                    break;
+            }
+            break;
+    }
+    return fetchCycles + execute;
+}
+
+Chip8::RunResult Chip8Timing::runFrame(Chip8& chip8) {
+    Chip8State& state = chip8.getState();
+    if (state.cyclesPerTick != cyclesPerTick)
+        chip8.setCyclesPerTimerTick(cyclesPerTick);
+
+    budget = frameBudget;
+    frameStart = true;
+    uint64_t frameEnd = state.cycleCount + cyclesPerTick - state.cycleCount % cyclesPerTick;
+    Chip8::RunResult result = chip8.run(*this, frameEnd - state.cycleCount);
+
+    // The rest of the frame is a wait for the display interrupt
+    state.cycleCount = frameEnd;
+    if (result.reason == Chip8::StopReason::Breakpoint)
+        result.reason = Chip8::StopReason::CycleLimit;
+    return result;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Chip8.h"
+#include <cstdint>
+#include <cstring>
+
+// COSMAC VIP timing model: charges every instruction the machine cycles
+// the VIP interpreter spends on it and ends each 60 Hz frame when the
+// cycles the CPU has left between display interrupts are used up. Run a
+// machine through runFrame() once per frame instead of Chip8::runFrame().
+//
+// A machine cycle is 8 clocks of the 1.7609 MHz CDP1802, 3668 per frame.
+// The CDP1861 display takes 1024 of them for DMA and the interrupt routine
+// some more; the interpreter gets the rest. The costs are approximations
+// of the interpreter's routines: a fixed fetch and decode, then a per-opcode
+// execution cost. DXYN depends on the sprite height and how far the sprite
+// is from byte alignment; FX33, FX55 and FX65 on their operands.
+//
+// DXYN first waits for the next display interrupt, as on the VIP, so it is
+// always the first instruction of a frame. An instruction that overruns the
+// frame still completes in it. Nothing is carried from one frame to the
+// next, so the model keeps no state of its own and movies, rewinds and
+// save states stay exact.
+//
+// The timers tick once per frame. The scheduler sets the machine's timer
+// rate above the most instructions a frame can hold and, at the end of
+// each frame, moves the instruction count on to the next tick, as a
+// fast-forwarded wait would. Busy waits are executed, not fast-forwarded.
+//
+// The model is a hooks policy for Chip8::run() (instantiated in Chip8.cpp),
+// so without it the interpreter loop is unchanged.
+class Chip8Timing {
+public:
+    static constexpr bool enabled = true;
+
+    // How a host paces a machine: a fixed number of instructions per frame
+    // (Chip8::runFrame()), or this model
+    enum class Model : uint16_t {
+        Instructions,
+        VIP,
+    };
+    static constexpr int modelCount = 2;
+
+    static const char* name(Model model) {
+        static const char* const names[modelCount] = { "instructions", "vip" };
+        return names[static_cast<int>(model)];
+    }
+
+    static bool parse(const char* text, Model& out) {
+        for (int m = 0; m < modelCount; ++m) {
+            if (strcmp(text, name(static_cast<Model>(m))) == 0) {
+                out = static_cast<Model>(m);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static constexpr uint32_t frameCycles = 3668;
+    static constexpr uint32_t displayCycles = 1024 + 56;   // DMA, interrupt routine
+    static constexpr uint32_t fetchCycles = 40;
+    static constexpr uint32_t minimumCost = fetchCycles + 6;
+
+    // Timer rate set on the machine: more instructions than fit in a frame
+    static constexpr uint32_t cyclesPerTick = (frameCycles - displayCycles) / minimumCost + 2;
+
+    // Machine cycles of `opcode`, executed on `state`, fetch included
+    static uint32_t cost(const Chip8State& state, uint16_t opcode);
+
+    Chip8Timing() : frameStart(false), budget(0), machineCycles(0) {}
+
+    // Run one frame: the instructions that fit in it, then the rest of it
+    // as a wait. A stop other than the cycle budget (a halt on an unknown
+    // opcode) is passed on.
+    Chip8::RunResult runFrame(Chip8& chip8);
+
+    // Machine cycles charged so far, fetch included
+    uint64_t getMachineCycles() const { return machineCycles; }
+
+    // Policy hooks, called by Chip8::run()
+    bool before(Chip8& chip8) {
+        const Chip8State& state = chip8.getState();
+        if (budget <= 0)
+            return false;
+        uint16_t address = state.pc & 0x0FFF;
+        uint16_t opcode = static_cast<uint16_t>(state.memory[address] << 8 | state.memory[(address + 1) & 0x0FFF]);
+        if ((opcode & 0xF000) == 0xD000 && !frameStart) {
+            budget = 0;             // Wait for the display interrupt
+            return false;
+        }
+        frameStart = false;
+        uint32_t cycles = cost(state, opcode);
+        budget -= cycles;
+        machineCycles += cycles;
+        return true;
+    }
+
+    bool after(Chip8&) { return true; }
+
+private:
+    bool frameStart;
+    int64_t budget;                 // Cycles left in this frame
+    uint64_t machineCycles;
+};
@@ -0,0 +1,132 @@
+#include "Chip8Trace.h"
+#include "Chip8.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const uint8_t magic[4] = { 'C', '8', 'T', 'R' };
+const size_t headerSize = 4 + 2 + 2 + 8 + 8;
+const size_t recordSize = 32;
+
+template<typename T>
+void putLE(uint8_t*& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i)
+        *out++ = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+}
+
+template<typename T>
+T getLE(const uint8_t*& in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<uint64_t>(*in++) << (8 * i);
+    return static_cast<T>(value);
+}
+
+} // namespace
+
+Chip8Trace::Chip8Trace(size_t capacity) : appended(0) {
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    records.resize(size);
+    mask = size - 1;
+}
+
+const Chip8Trace::Record& Chip8Trace::at(size_t index) const {
+    uint64_t first = appended - size();
+    return records[(first + index) & mask];
+}
+
+bool Chip8Trace::save(const char* filename, size_t last) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    size_t count = last && last < size() ? last : size();
+    uint8_t header[headerSize];
+    uint8_t* out = header;
+    memcpy(out, magic, sizeof(magic));
+    out += sizeof(magic);
+    putLE<uint16_t>(out, version);
+    putLE<uint16_t>(out, recordSize);
+    putLE<uint64_t>(out, appended);
+    putLE<uint64_t>(out, count);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    // Encode in chunks so a trace of millions of records needs no second copy
+    std::vector<uint8_t> chunk(4096 * recordSize);
+    for (size_t i = size() - count; i < size(); ) {
+        out = chunk.data();
+        for (size_t n = 0; n < 4096 && i < size(); ++n, ++i) {
+            const Record& record = at(i);
+            putLE(out, record.cycle);
+            putLE(out, record.pc);
+            putLE(out, record.opcode);
+            putLE(out, record.changed);
+            putLE(out, record.I);
+            memcpy(out, record.V, 16);
+            out += 16;
+        }
+        file.write(reinterpret_cast<const char*>(chunk.data()), out - chunk.data());
+    }
+    return static_cast<bool>(file);
+}
+
+bool Chip8Trace::load(const char* filename, std::vector<Record>& out, uint64_t* total) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    uint8_t header[headerSize];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || memcmp(header, magic, sizeof(magic)) != 0)
+        return false;
+    const uint8_t* in = header + sizeof(magic);
+    uint16_t saved = getLE<uint16_t>(in);
+    uint16_t size = getLE<uint16_t>(in);
+    uint64_t appended = getLE<uint64_t>(in);
+    uint64_t count = getLE<uint64_t>(in);
+    if (saved == 0 || saved > version || size != recordSize)
+        return false;
+
+    std::vector<Record> records;
+    std::vector<uint8_t> chunk(4096 * recordSize);
+    while (records.size() < count) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(4096, count - records.size()));
+        if (!file.read(reinterpret_cast<char*>(chunk.data()), n * recordSize))
+            return false;
+        in = chunk.data();
+        for (size_t i = 0; i < n; ++i) {
+            Record record;
+            record.cycle = getLE<uint64_t>(in);
+            record.pc = getLE<uint16_t>(in);
+            record.opcode = getLE<uint16_t>(in);
+            record.changed = getLE<uint16_t>(in);
+            record.I = getLE<uint16_t>(in);
+            memcpy(record.V, in, 16);
+            in += 16;
+            records.push_back(record);
+        }
+    }
+
+    out.swap(records);
+    if (total)
+        *total = appended;
+    return true;
+}
+
+std::string Chip8Trace::format(const Record& record, const Record* previous) {
+    char line[160];
+    int length = snprintf(line, sizeof(line), "%12llu  %03X  %04X  %-7s",
+                          static_cast<unsigned long long>(record.cycle), record.pc, record.opcode,
+                          Chip8::opcodeFamilyName(Chip8::opcodeFamily(record.opcode)));
+    for (int i = 0; i < 16; ++i) {
+        if (record.changed & (1u << i))
+            length += snprintf(line + length, sizeof(line) - length, " V%X=%02X", i, record.V[i]);
+    }
+    if (previous && previous->I != record.I)
+        snprintf(line + length, sizeof(line) - length, " I=%03X", record.I);
+    return line;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Execution trace of the most recent instructions in a fixed-size ring.
+// Attach it with Chip8::setTrace(); every interpreted instruction then
+// appends one 32-byte record. Recording is a few stores, so a trace can
+// stay attached in normal use and be saved when something goes wrong.
+// chip8_trace decodes and filters saved traces.
+//
+// File layout, all integers little endian:
+//   "C8TR"   magic
+//   u16      format version
+//   u16      record size, 32
+//   u64      records appended in total (older ones were overwritten)
+//   u64      records in the file
+//   records  oldest first: u64 cycle, u16 pc, u16 opcode, u16 changed,
+//            u16 I, then V0-VF
+class Chip8Trace {
+public:
+    static constexpr uint16_t version = 1;
+
+    // Machine state right after the instruction at `pc` ran
+    struct Record {
+        uint64_t cycle;         // Instruction count before it ran
+        uint16_t pc;
+        uint16_t opcode;
+        uint16_t changed;       // Bit n set if Vn changed
+        uint16_t I;
+        uint8_t V[16];
+    };
+    static_assert(sizeof(Record) == 32, "Trace records are 32 bytes");
+
+    // Capacity in records, rounded up to a power of two
+    explicit Chip8Trace(size_t capacity = 1 << 20);
+
+    Chip8Trace(const Chip8Trace&) = delete;
+    Chip8Trace& operator=(const Chip8Trace&) = delete;
+
+    Record& append() { return records[appended++ & mask]; }
+    void clear() { appended = 0; }
+
+    uint64_t total() const { return appended; }    // Appended since clear()
+    size_t size() const { return appended < records.size() ? static_cast<size_t>(appended) : records.size(); }
+    size_t capacity() const { return records.size(); }
+    const Record& at(size_t index) const;           // 0 = oldest still held
+
+    // Write the newest `last` records, all of them if 0
+    bool save(const char* filename, size_t last = 0) const;
+    // Read a saved trace. `total` receives the appended count it was saved with.
+    static bool load(const char* filename, std::vector<Record>& out, uint64_t* total = nullptr);
+
+    // One line of text: cycle, address, opcode, family and the registers it
+    // changed. I is shown when it differs from `previous`, if given.
+    static std::string format(const Record& record, const Record* previous = nullptr);
+
+private:
+    std::vector<Record> records;
+    uint64_t mask;
+    uint64_t appended;
+};
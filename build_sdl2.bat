@@ -9,7 +9,7 @@ set SDL2_INCLUDE=SDL2-2.30.9\include
 set SDL2_LIB=SDL2-2.30.9\lib\x64
 
 REM Compile with SDL2
-g++ -std=c++11 -Wall -O2 -I"%SDL2_INCLUDE%" -o chip8_sdl2.exe Chip8.cpp main.cpp -L"%SDL2_LIB%" -lSDL2main -lSDL2
+g++ -std=c++17 -Wall -O2 -I"%SDL2_INCLUDE%" -o chip8_sdl2.exe Chip8.cpp Chip8Debugger.cpp Chip8Expand.cpp Chip8Faults.cpp Chip8Movie.cpp Chip8Pool.cpp Chip8Profile.cpp Chip8Rewind.cpp Chip8SaveState.cpp Chip8Timing.cpp Chip8Trace.cpp main.cpp -L"%SDL2_LIB%" -lSDL2main -lSDL2
 
 if %ERRORLEVEL% EQU 0 (
     echo.
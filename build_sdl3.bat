@@ -15,7 +15,7 @@ if not exist "%SDL3_PATH%" (
 echo Compiling with SDL3...
 g++ -std=c++17 -Wall -Wextra -O2 ^
     -I"%SDL3_PATH%\include" ^
-    main.cpp Chip8.cpp ^
+    main.cpp Chip8.cpp Chip8Debugger.cpp Chip8Expand.cpp Chip8Faults.cpp Chip8Movie.cpp Chip8Pool.cpp Chip8Profile.cpp Chip8Rewind.cpp Chip8SaveState.cpp Chip8Timing.cpp Chip8Trace.cpp ^
     -o chip8_emulator.exe ^
     -L"%SDL3_PATH%\lib\x64" ^
     -lSDL3
@@ -1,9 +1,15 @@
 #include "Chip8.h"
+#include "Chip8Expand.h"
+#include "Chip8Movie.h"
+#include "Chip8Timing.h"
+#include "Chip8Rewind.h"
 #include <SDL.h>  //magic (error handled in build batch file)
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <random>
 #include <cmath>
+#include <string>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -73,10 +79,40 @@ uint8_t keymap[16] = {
 };
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <ROM file>" << std::endl;
+    const char* romFile = nullptr;
+    const char* movieFile = nullptr;    // Session recording, see chip8_replay
+    Chip8Quirks::Profile quirks = Chip8Quirks::Profile::Default;
+    Chip8Timing::Model timingModel = Chip8Timing::Model::Instructions;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            movieFile = argv[++i];
+        else if (arg == "--quirks" && i + 1 < argc)
+            usage = !Chip8Quirks::parse(argv[++i], quirks);
+        else if (arg == "--timing" && i + 1 < argc)
+            usage = !Chip8Timing::parse(argv[++i], timingModel);
+        else if (!romFile && !arg.empty() && arg[0] != '-')
+            romFile = argv[i];
+        else
+            usage = true;
+    }
+    if (usage || !romFile) {
+        std::cerr << "Usage: " << argv[0] << " [--record <movie file>] [--quirks <profile>] [--timing <model>] <ROM file>\n"
+                  << "Quirk profiles: default, vip, chip48, schip, xochip\n"
+                  << "Timing models: instructions (fixed instructions per frame), vip (COSMAC VIP cycle costs)"
+                  << std::endl;
+        return 1;
+    }
+
+    // Initialize CHIP-8 system and load ROM, before any window is opened
+    const int instructionsPerFrame = 5; 
+    Chip8 chip8;
+    chip8.setQuirks(quirks);
+    if (!chip8.loadRom(romFile))
         return 1;
-    }    // Initialize SDL
+
+    // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return 1;
@@ -126,13 +162,22 @@ int main(int argc, char* argv[]) {
         SDL_PauseAudioDevice(audioDevice, 0); // Start audio playback (bugged currently :(   )
     }
 
-    // Initialize CHIP-8 system and load ROM
-    Chip8 chip8;
-    chip8.loadRom(argv[1]);    // Main loop
+    // All input goes through the movie, so the session can be saved and replayed
+    Chip8Movie movie;
+    movie.begin(chip8, romFile, std::random_device{}(), instructionsPerFrame, timingModel);
+    Chip8Timing timing;     // Paces the frames under the VIP model
+
+    // Main loop
     bool quit = false;
     SDL_Event e;    auto lastTime = std::chrono::high_resolution_clock::now();
-    const std::chrono::microseconds targetFrameTime(45000); //speed
-    const int instructionsPerFrame = 5; 
+    const std::chrono::microseconds targetFrameTime(16667); // 60 Hz, one timer tick per frame
+    uint32_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT]; // Texture contents, kept between frames
+
+    // Rewind history, one capture per frame, stepped back while Backspace is held
+    Chip8Rewind rewindBuffer;
+    Chip8State rewindState;
+    bool rewinding = false;
+    rewindBuffer.capture(chip8.getState());
 
     std::cout << "CHIP-8 Emulator Controls:" << std::endl;
     std::cout << "CHIP-8 Key -> PC Key" << std::endl;
@@ -140,6 +185,7 @@ int main(int argc, char* argv[]) {
     std::cout << "4 5 6 D -> Q W E R" << std::endl;
     std::cout << "7 8 9 E -> A S D F" << std::endl;
     std::cout << "A 0 B F -> Z X C V" << std::endl;
+    std::cout << "Hold Backspace to rewind" << std::endl;
     std::cout << "Press ESC to quit" << std::endl;
 
     while (!quit) {        auto currentTime = std::chrono::high_resolution_clock::now();
@@ -152,36 +198,68 @@ int main(int argc, char* argv[]) {
                 if (e.key.keysym.sym == SDLK_ESCAPE) {
                     quit = true;
                 }
+                if (e.key.keysym.sym == SDLK_BACKSPACE) {
+                    rewinding = true;
+                }
                 
                 // Handle keys
                 for (int i = 0; i < 16; ++i) {
                     if (e.key.keysym.sym == keymap[i]) {
-                        chip8.setKey(i, true);
+                        movie.setKey(chip8, i, true);
                         break;
                     }
                 }
             }
             else if (e.type == SDL_KEYUP) {
+                if (e.key.keysym.sym == SDLK_BACKSPACE) {
+                    // The restored state remembers old key presses, use the real ones
+                    rewinding = false;
+                    const Uint8* keyboard = SDL_GetKeyboardState(nullptr);
+                    for (int i = 0; i < 16; ++i)
+                        movie.setKey(chip8, i, keyboard[SDL_GetScancodeFromKey(keymap[i])] != 0);
+                }
+
                 // Handle keys
                 for (int i = 0; i < 16; ++i) {
                     if (e.key.keysym.sym == keymap[i]) {
-                        chip8.setKey(i, false);
+                        movie.setKey(chip8, i, false);
                         break;
                     }
                 }
-            }        }        // Execute single cycle
-        for (int i = 0; i < instructionsPerFrame; ++i) {
-            chip8.cycle();
-        }// Update display if draw flag is set
+            }        }        // Execute one frame worth of instructions
+        if (!rewinding) {
+            if (timingModel == Chip8Timing::Model::VIP)
+                timing.runFrame(chip8);
+            else
+                chip8.runFrame(instructionsPerFrame);
+            rewindBuffer.capture(chip8.getState());
+        } else if (rewindBuffer.rewind(rewindState)) {
+            chip8.restore(rewindState);
+            movie.truncate(chip8.getCycleCount());
+        }
+
+        // Update display if draw flag is set
         if (chip8.drawFlag) {
-            // Convert CHIP-8 display to SDL texture format
-            uint32_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
-            for (int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; ++i) {
-                pixels[i] = chip8.display[i] ? 0xFFFFFFFF : 0xFF000000; // White or black
+            // Convert and upload only the rows that changed, one span at a time
+            uint32_t dirtyRows = chip8.takeDirtyRows();
+            const uint64_t* framebuffer = chip8.getFramebuffer();
+            bool uploaded = true;
+            for (int y = 0; y < DISPLAY_HEIGHT; ) {
+                if (!(dirtyRows & (1u << y))) {
+                    ++y;
+                    continue;
+                }
+                int first = y;
+                while (y < DISPLAY_HEIGHT && (dirtyRows & (1u << y)))
+                    ++y;
+                Chip8Expand::expand(framebuffer + first, y - first, 0xFF000000, 0xFFFFFFFF, // Black or white
+                                    pixels + first * DISPLAY_WIDTH, DISPLAY_WIDTH * sizeof(uint32_t));
+                SDL_Rect span = { 0, first, DISPLAY_WIDTH, y - first };
+                if (SDL_UpdateTexture(texture, &span, pixels + first * DISPLAY_WIDTH, DISPLAY_WIDTH * sizeof(uint32_t)) != 0)
+                    uploaded = false;
             }
-            
-            // Update texture with display data
-            if (SDL_UpdateTexture(texture, nullptr, pixels, DISPLAY_WIDTH * sizeof(uint32_t)) == 0) {
+
+            if (uploaded) {
                 // Clear screen
                 SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
                 SDL_RenderClear(renderer);
@@ -208,6 +286,16 @@ int main(int argc, char* argv[]) {
         }
         lastTime = currentTime;    }
 
+    chip8.getFaults().writeSummary(stderr);
+
+    if (movieFile) {
+        movie.end(chip8);
+        if (movie.save(movieFile))
+            std::cout << "Recorded " << movie.events.size() << " key events to " << movieFile << std::endl;
+        else
+            std::cerr << "Error: Could not write movie " << movieFile << std::endl;
+    }
+
     // Cleanup
     if (audioDevice != 0) {
         SDL_CloseAudioDevice(audioDevice);
@@ -0,0 +1,284 @@
+// Headless benchmark: runs one ROM flat out, with no pacing, display or
+// input, and reports interpreter or translation backend throughput. Every
+// run starts from the same power-on state, so the numbers of two builds or
+// backends are directly comparable and the printed state hash shows that
+// they did the same work.
+#include "Chip8.h"
+#ifdef CHIP8_BENCH_AOT
+#include "Chip8Aot.h"
+#endif
+#include "Chip8Movie.h"
+#include "Chip8Profile.h"
+#include "Chip8Timing.h"
+#include "Chip8Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// What executes the instructions
+enum class Backend {
+    Interpreter,        // Chip8's run calls
+    Aot,                // Chip8Aot, only in chip8_bench_aot
+};
+
+struct Options {
+    const char* rom = nullptr;
+    uint64_t cycles = 0;            // Instruction budget, overrides frames
+    uint64_t frames = 1000000;      // 10 million instructions at the default -i
+    int instructionsPerFrame = 10;
+    int runs = 3;                   // Best run is reported
+    uint64_t seed = 1;
+    bool step = false;              // One cycle() call per instruction
+    Backend backend = Backend::Interpreter;
+    Chip8Quirks::Profile quirks = Chip8Quirks::Profile::Default;
+    Chip8Timing::Model timing = Chip8Timing::Model::Instructions;
+    std::string profile;            // Report format: json, csv or flat
+    const char* profileFile = nullptr;  // Defaults to stdout
+    size_t trace = 0;               // Trace ring capacity, 0 = no tracing
+    const char* traceFile = nullptr;
+};
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] <ROM file>\n"
+            "  -c <cycles>            Instructions to run (overrides -f)\n"
+            "  -f <frames>            Frames to run (default: 1000000)\n"
+            "  -i <count>             Instructions per frame (default: 10)\n"
+            "  -r <runs>              Repetitions, the fastest is reported (default: 3)\n"
+            "  -s <seed>              Random seed (default: 1)\n"
+            "  --quirks <profile>     default, vip, chip48, schip or xochip\n"
+            "  --backend <name>       interpreter (default) or, in chip8_bench_aot, aot (the\n"
+            "                         ROM it was built with, busy waits are not fast-forwarded)\n"
+            "  --timing <model>       instructions (-i per frame) or vip (COSMAC VIP cycle\n"
+            "                         costs, frames only)\n"
+            "  --step                 Execute through cycle() one instruction at a time,\n"
+            "                         without fast-forwarding busy waits\n"
+            "  --profile <format>     Profile the last run: json, csv or flat (hot spots),\n"
+            "                         needs a CHIP8_PROFILE build\n"
+            "  --profile-out <file>   Write the profile there instead of stdout\n"
+            "  --trace <records>      Run with a Chip8Trace of this capacity attached\n"
+            "  --trace-out <file>     Save the trace of the last run, see chip8_trace\n",
+            program);
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--step")
+            options.step = true;
+        else if (arg == "--profile" && hasValue)
+            options.profile = argv[++i];
+        else if (arg == "--profile-out" && hasValue)
+            options.profileFile = argv[++i];
+        else if (arg == "--trace" && hasValue)
+            options.trace = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 0));
+        else if (arg == "--trace-out" && hasValue)
+            options.traceFile = argv[++i];
+        else if (arg == "--quirks" && hasValue) {
+            if (!Chip8Quirks::parse(argv[++i], options.quirks))
+                return false;
+        }
+        else if (arg == "--backend" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "interpreter")
+                options.backend = Backend::Interpreter;
+#ifdef CHIP8_BENCH_AOT
+            else if (name == "aot")
+                options.backend = Backend::Aot;
+#endif
+            else
+                return false;
+        }
+        else if (arg == "--timing" && hasValue) {
+            if (!Chip8Timing::parse(argv[++i], options.timing))
+                return false;
+        }
+        else if (arg == "-c" && hasValue)
+            options.cycles = std::strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-f" && hasValue)
+            options.frames = std::strtoull(argv[++i], nullptr, 0);
+        else if (arg == "-i" && hasValue)
+            options.instructionsPerFrame = std::atoi(argv[++i]);
+        else if (arg == "-r" && hasValue)
+            options.runs = std::atoi(argv[++i]);
+        else if (arg == "-s" && hasValue)
+            options.seed = std::strtoull(argv[++i], nullptr, 0);
+        else if (!arg.empty() && arg[0] == '-')
+            return false;
+        else if (!options.rom)
+            options.rom = argv[i];
+        else
+            return false;
+    }
+    bool profileFormat = options.profile.empty() || options.profile == "json" || options.profile == "csv" ||
+                         options.profile == "flat";
+    if (options.traceFile && options.trace == 0)
+        options.trace = 1 << 20;
+    bool vipTiming = options.timing == Chip8Timing::Model::VIP;
+    if (vipTiming && (options.cycles > 0 || options.step))
+        return false;   // The model paces whole frames
+    if (options.backend != Backend::Interpreter && (vipTiming || options.step))
+        return false;   // Both drive the interpreter themselves
+    return options.rom && options.instructionsPerFrame > 0 && options.runs > 0 && profileFormat &&
+           (options.cycles > 0 || options.frames > 0);
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!options.profile.empty() && !Chip8::profilingEnabled) {
+        fprintf(stderr, "Error: --profile needs a build with CHIP8_PROFILE defined\n");
+        return 1;
+    }
+
+    std::unique_ptr<Chip8> chip8(new Chip8());
+    if (!chip8->loadRom(options.rom))
+        return 1;
+    chip8->setQuirks(options.quirks);
+    chip8->seedRandom(options.seed);
+    bool vipTiming = options.timing == Chip8Timing::Model::VIP;
+    chip8->setCyclesPerTimerTick(vipTiming ? static_cast<int>(Chip8Timing::cyclesPerTick)
+                                           : options.instructionsPerFrame);
+    std::unique_ptr<Chip8State> start(new Chip8State);
+    chip8->snapshot(*start);
+
+    std::unique_ptr<Chip8Profile> profile;
+    if (!options.profile.empty()) {
+        profile.reset(new Chip8Profile());
+        chip8->setProfile(profile.get());
+    }
+    std::unique_ptr<Chip8Trace> trace;
+    if (options.trace) {
+        trace.reset(new Chip8Trace(options.trace));
+        chip8->setTrace(trace.get());
+    }
+#ifdef CHIP8_BENCH_AOT
+    std::unique_ptr<Chip8Aot> aot(options.backend == Backend::Aot ? new Chip8Aot(*chip8) : nullptr);
+    if (aot && memcmp(start->memory + 0x200, Chip8Aot::romImage, Chip8Aot::romSize) != 0)
+        fprintf(stderr, "Warning: %s is not the ROM this build was recompiled from, it runs interpreted\n",
+                options.rom);
+#endif
+    bool translated = options.backend != Backend::Interpreter;
+    auto runTranslated = [&](uint64_t cycles) {
+#ifdef CHIP8_BENCH_AOT
+        while (cycles > 0) {
+            int chunk = static_cast<int>(std::min<uint64_t>(cycles, INT_MAX));
+            aot->run(chunk);
+            cycles -= chunk;
+        }
+#else
+        (void)cycles;       // Only the interpreter is built in
+#endif
+    };
+
+    uint64_t budget = options.cycles ? options.cycles
+                                     : options.frames * static_cast<uint64_t>(options.instructionsPerFrame);
+    double best = 0.0;
+    uint64_t stateHash = 0;
+    uint64_t executed = 0;          // Under the VIP model, without the waits that end frames
+    uint64_t skipped = 0;           // Busy waits fast-forwarded by the interpreter
+    uint64_t machineCycles = 0;
+    for (int run = 0; run < options.runs; ++run) {
+        chip8->restore(*start);
+        if (profile)
+            profile->clear();     // Keep the last run only
+        if (trace)
+            trace->clear();
+        chip8->getFaults().clear();
+        if (run > 0)
+            chip8->getFaults().setLogLimit(0);    // Logged by the first run already
+
+        uint64_t skippedBefore = chip8->getSkippedCycles();
+        auto begin = std::chrono::steady_clock::now();
+        if (options.step) {
+            for (uint64_t i = 0; i < budget; ++i)
+                chip8->cycle();
+        } else if (vipTiming) {
+            Chip8Timing timing;
+            executed = 0;
+            for (uint64_t frame = 0; frame < options.frames; ++frame)
+                executed += timing.runFrame(*chip8).cycles;
+            machineCycles = timing.getMachineCycles();
+        } else if (translated && options.cycles) {
+            runTranslated(budget);
+        } else if (translated) {
+            // Frames as runFrame() counts them: up to the next timer tick
+            uint32_t perTick = chip8->getState().cyclesPerTick;
+            for (uint64_t frame = 0; frame < options.frames; ++frame)
+                runTranslated(perTick - chip8->getCycleCount() % perTick);
+        } else if (options.cycles) {
+            chip8->runCycles(budget);
+        } else {
+            for (uint64_t frame = 0; frame < options.frames; ++frame)
+                chip8->runFrame(options.instructionsPerFrame);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        skipped = chip8->getSkippedCycles() - skippedBefore;
+
+        uint64_t hash = Chip8Movie::hashState(*chip8);
+        if (run > 0 && hash != stateHash) {
+            fprintf(stderr, "Error: run %d ended in a different state\n", run + 1);
+            return 2;
+        }
+        stateHash = hash;
+        best = run == 0 ? seconds : std::min(best, seconds);
+    }
+
+    // Only executed instructions count towards MIPS, not the busy waits the
+    // interpreter fast-forwarded. The VIP model executes every instruction;
+    // the instruction count it adds to end each frame is not work done.
+    uint64_t total = chip8->getCycleCount() - start->cycleCount;
+    uint64_t cycles = vipTiming ? executed : total - skipped;
+    double frames = vipTiming ? static_cast<double>(options.frames)
+                              : static_cast<double>(total) / options.instructionsPerFrame;
+    best = std::max(best, 1e-9);
+    printf("%llu instructions executed, %llu fast-forwarded, %.0f frames, best of %d runs: %.6f s\n",
+           static_cast<unsigned long long>(cycles), static_cast<unsigned long long>(vipTiming ? 0 : skipped), frames,
+           options.runs, best);
+    printf("%.2f MIPS, %.2f ns per instruction, %.0f frames per second\n",
+           cycles / best / 1e6, best * 1e9 / std::max<uint64_t>(cycles, 1), frames / best);
+    printf("State hash %016llx\n", static_cast<unsigned long long>(stateHash));
+    chip8->getFaults().writeSummary(stdout);
+    if (vipTiming)
+        printf("VIP timing: %.1f instructions and %.0f machine cycles per frame, busy waits were executed\n",
+               cycles / frames, machineCycles / frames);
+    else if (translated)
+        printf("Chip8Aot backend, busy waits were executed\n");
+    else if (skipped)
+        printf("Busy waits were fast-forwarded, use --step to execute them\n");
+    if (trace)
+        printf("Tracing into %zu records was on, busy waits were executed\n", trace->capacity());
+    if (trace && options.traceFile && !trace->save(options.traceFile)) {
+        fprintf(stderr, "Error: Could not write %s\n", options.traceFile);
+        return 1;
+    }
+
+    if (profile) {
+        printf("Profiling was on, timings include its overhead\n");
+        FILE* out = options.profileFile ? fopen(options.profileFile, "w") : stdout;
+        if (!out) {
+            fprintf(stderr, "Error: Could not write %s\n", options.profileFile);
+            return 1;
+        }
+        if (options.profile == "json")
+            profile->writeJson(out);
+        else if (options.profile == "csv")
+            profile->writeCsv(out);
+        else
+            profile->writeHotSpots(out);
+        if (out != stdout)
+            fclose(out);
+    }
+    return 0;
+}
@@ -1,7 +1,11 @@
 #include "Chip8.h"
+#include "Chip8Movie.h"
+#include "Chip8Timing.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
+#include <random>
+#include <string>
 #include <conio.h> // For Windows console input
 
 const int DISPLAY_WIDTH = 64;
@@ -32,18 +36,46 @@ void printControls() {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <ROM file>" << std::endl;
+    const char* romFile = nullptr;
+    const char* movieFile = nullptr;    // Session recording, see chip8_replay
+    Chip8Quirks::Profile quirks = Chip8Quirks::Profile::Default;
+    Chip8Timing::Model timingModel = Chip8Timing::Model::Instructions;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            movieFile = argv[++i];
+        else if (arg == "--quirks" && i + 1 < argc)
+            usage = !Chip8Quirks::parse(argv[++i], quirks);
+        else if (arg == "--timing" && i + 1 < argc)
+            usage = !Chip8Timing::parse(argv[++i], timingModel);
+        else if (!romFile && !arg.empty() && arg[0] != '-')
+            romFile = argv[i];
+        else
+            usage = true;
+    }
+    if (usage || !romFile) {
+        std::cerr << "Usage: " << argv[0] << " [--record <movie file>] [--quirks <profile>] [--timing <model>] <ROM file>\n"
+                  << "Quirk profiles: default, vip, chip48, schip, xochip\n"
+                  << "Timing models: instructions (fixed instructions per frame), vip (COSMAC VIP cycle costs)"
+                  << std::endl;
         return 1;
     }    // Initialize CHIP-8 system and load ROM
+    const int instructionsPerFrame = 10; // Execute multiple instructions per frame for normal speed
     Chip8 chip8;
-    // chip8.enableDebugMode(true); // Disabled debug output for normal speed
-    chip8.loadRom(argv[1]);
+    // chip8.setTrace(...) records every instruction for debugging, see Chip8Trace
+    chip8.setQuirks(quirks);
+    if (!chip8.loadRom(romFile))
+        return 1;
+
+    // All input goes through the movie, so the session can be saved and replayed
+    Chip8Movie movie;
+    movie.begin(chip8, romFile, std::random_device{}(), instructionsPerFrame, timingModel);
+    Chip8Timing timing;     // Paces the frames under the VIP model
 
     printControls();    // Main loop
     bool quit = false;    auto lastTime = std::chrono::high_resolution_clock::now();
     const std::chrono::milliseconds targetFrameTime(16); // ~60 FPS (16.67ms per frame) for normal speed
-    const int instructionsPerFrame = 10; // Execute multiple instructions per frame for normal speed
 
     while (!quit) {
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -86,18 +118,19 @@ int main(int argc, char* argv[]) {
             }
             
             if (chip8Key != -1) {
-                chip8.setKey(chip8Key, true);
+                movie.setKey(chip8, chip8Key, true);
                 // Simulate key release after a short time
                 std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                chip8.setKey(chip8Key, false);
-            }        }        // Execute single CHIP-8 cycle for slow debugging
-        for (int i = 0; i < instructionsPerFrame; ++i) {
-            chip8.cycle();
-        }
+                movie.setKey(chip8, chip8Key, false);
+            }        }        // Execute one frame worth of instructions
+        if (timingModel == Chip8Timing::Model::VIP)
+            timing.runFrame(chip8);
+        else
+            chip8.runFrame(instructionsPerFrame);
 
         // Update display if draw flag is set
         if (chip8.drawFlag) {
-            printDisplay(chip8.display);
+            printDisplay(chip8.getDisplay());
             chip8.drawFlag = false;
         }
 
@@ -114,5 +147,15 @@ int main(int argc, char* argv[]) {
         lastTime = currentTime;
     }
 
+    chip8.getFaults().writeSummary(stderr);
+
+    if (movieFile) {
+        movie.end(chip8);
+        if (movie.save(movieFile))
+            std::cout << "Recorded " << movie.events.size() << " key events to " << movieFile << std::endl;
+        else
+            std::cerr << "Error: Could not write movie " << movieFile << std::endl;
+    }
+
     return 0;
 }
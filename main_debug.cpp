@@ -1,7 +1,12 @@
 #include "Chip8.h"
+#include "Chip8Debugger.h"
+#include "Chip8Trace.h"
 #include <iostream>
+#include <iomanip>
+#include <string>
 #include <chrono>
 #include <thread>
+#include <random>
 #include <conio.h> // For Windows console input
 
 const int DISPLAY_WIDTH = 64;
@@ -26,6 +31,54 @@ void printDisplay(const uint32_t* display) {
     }
 }
 
+// Stops the run when one of the selected registers changes
+class RegisterWatch : public Chip8RegisterObserver {
+public:
+    uint32_t watched = 0;   // Bit n = Vn, bit 16 = I
+
+    bool registerChanged(Chip8&, int reg, uint16_t oldValue, uint16_t newValue) override {
+        if (!(watched & (1u << reg)))
+            return false;
+        std::cout << (reg == Chip8Debugger::registerI ? std::string("I") : "V" + std::string(1, "0123456789ABCDEF"[reg]))
+                  << ": " << std::hex << oldValue << " -> " << newValue << std::dec << std::endl;
+        return true;
+    }
+};
+
+// Read a hex number typed on its own line
+bool promptHex(const char* question, unsigned& value) {
+    std::cout << question << std::flush;
+    std::string line;
+    if (!std::getline(std::cin, line) || line.empty())
+        return false;
+    try {
+        value = std::stoul(line, nullptr, 16);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+void printRegisters(const Chip8State& state) {
+    std::cout << std::hex << std::uppercase << std::setfill('0');
+    std::cout << "PC=" << std::setw(3) << state.pc << " I=" << std::setw(3) << state.I << " SP=" << int(state.sp) << "\n";
+    for (int i = 0; i < 16; ++i)
+        std::cout << "V" << i << "=" << std::setw(2) << int(state.V[i]) << (i % 8 == 7 ? "\n" : " ");
+    std::cout << std::dec << std::nouppercase << std::setfill(' ');
+}
+
+void printHit(const Chip8Debugger::Hit& hit) {
+    std::cout << std::hex << std::uppercase << "Stopped at 0x" << hit.pc << ": ";
+    switch (hit.kind) {
+        case Chip8Debugger::Hit::Breakpoint: std::cout << "breakpoint"; break;
+        case Chip8Debugger::Hit::Read:       std::cout << "read of 0x" << hit.address; break;
+        case Chip8Debugger::Hit::Write:      std::cout << "write to 0x" << hit.address; break;
+        case Chip8Debugger::Hit::Register:   std::cout << "watched register changed"; break;
+        default:                             std::cout << "stopped"; break;
+    }
+    std::cout << std::dec << std::nouppercase << std::endl;
+}
+
 void printControls() {
     std::cout << "\nCHIP-8 Debug Emulator Controls:" << std::endl;
     std::cout << "CHIP-8 Key -> PC Key" << std::endl;
@@ -39,19 +92,36 @@ void printControls() {
     std::cout << "3 = 500ms delay (medium debug)" << std::endl;
     std::cout << "4 = 100ms delay (fast debug)" << std::endl;
     std::cout << "5 = 16ms delay (normal speed)" << std::endl;
+    std::cout << "\nDebugger:" << std::endl;
+    std::cout << "P = pause / resume, N = step one instruction while paused" << std::endl;
+    std::cout << "B = toggle a breakpoint, I = show registers" << std::endl;
+    std::cout << "M = watch writes to an address, K = watch reads of an address" << std::endl;
+    std::cout << "G = stop when a register (0-F, or 10 for I) changes" << std::endl;
     std::cout << "ESC = quit" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <ROM file>" << std::endl;
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <ROM file> [trace file]" << std::endl;
         return 1;
     }
+    const char* traceFile = argc == 3 ? argv[2] : nullptr;   // Written on exit, see chip8_trace
 
     // Initialize CHIP-8 system and load ROM
     Chip8 chip8;
-    chip8.enableDebugMode(true); // Enable debug output
-    chip8.loadRom(argv[1]);
+    Chip8Trace trace;
+    chip8.seedRandom(std::random_device{}());
+    chip8.setTrace(&trace);
+    if (!chip8.loadRom(argv[1]))
+        return 1;
+    bool printTrace = true; // Print every instruction at the debug speeds
+
+    // Instructions run through the debugger policy, see Chip8::run()
+    Chip8Debugger debugger;
+    RegisterWatch registerWatch;
+    debugger.setRegisterObserver(&registerWatch);
+    bool paused = false;
+    bool stepOnce = false;
 
     printControls();
 
@@ -80,33 +150,75 @@ int main(int argc, char* argv[]) {
                 continue;
             }
             
+            // Debugger controls
+            unsigned value;
+            switch (key) {
+                case 'p':
+                    paused = !paused;
+                    std::cout << (paused ? "Paused" : "Resumed") << std::endl;
+                    break;
+                case 'n':
+                    stepOnce = paused;
+                    break;
+                case 'i':
+                    printRegisters(chip8.getState());
+                    break;
+                case 'b':
+                    if (promptHex("Breakpoint address (hex): ", value)) {
+                        debugger.setBreakpoint(value, !debugger.isBreakpoint(value));
+                        std::cout << "Breakpoint at 0x" << std::hex << value << std::dec
+                                  << (debugger.isBreakpoint(value) ? " set" : " removed") << std::endl;
+                    }
+                    break;
+                case 'm':
+                case 'k':
+                    if (promptHex("Watch address (hex): ", value)) {
+                        uint8_t flag = key == 'm' ? Chip8Debugger::WatchWrite : Chip8Debugger::WatchRead;
+                        bool on = !(debugger.watchFlags(value) & flag);
+                        debugger.watch(value, 1, flag, on);
+                        std::cout << (key == 'm' ? "Write" : "Read") << " watch at 0x" << std::hex << value << std::dec
+                                  << (on ? " set" : " removed") << std::endl;
+                    }
+                    break;
+                case 'g':
+                    if (promptHex("Register (0-F, 10 for I): ", value) && value <= 16) {
+                        registerWatch.watched ^= 1u << value;
+                        std::cout << "Register watch " << ((registerWatch.watched >> value) & 1 ? "set" : "removed") << std::endl;
+                    }
+                    break;
+            }
+
             // Speed controls
             switch (key) {
                 case '1': 
                     currentDelay = 2000; 
+                    printTrace = true;
                     targetFrameTime = std::chrono::milliseconds(currentDelay);
                     std::cout << "Speed set to 2000ms (very slow debug)" << std::endl;
                     break;
                 case '2': 
                     currentDelay = 1000; 
+                    printTrace = true;
                     targetFrameTime = std::chrono::milliseconds(currentDelay);
                     std::cout << "Speed set to 1000ms (slow debug)" << std::endl;
                     break;
                 case '3': 
                     currentDelay = 500; 
+                    printTrace = true;
                     targetFrameTime = std::chrono::milliseconds(currentDelay);
                     std::cout << "Speed set to 500ms (medium debug)" << std::endl;
                     break;
                 case '4': 
                     currentDelay = 100; 
+                    printTrace = true;
                     targetFrameTime = std::chrono::milliseconds(currentDelay);
                     std::cout << "Speed set to 100ms (fast debug)" << std::endl;
                     break;
                 case '5': 
                     currentDelay = 16; 
                     targetFrameTime = std::chrono::milliseconds(currentDelay);
-                    chip8.enableDebugMode(false); // Disable debug at normal speed
-                    std::cout << "Speed set to 16ms (normal speed, debug off)" << std::endl;
+                    printTrace = false; // Keep recording, stop printing at normal speed
+                    std::cout << "Speed set to 16ms (normal speed, trace printing off)" << std::endl;
                     break;
             }
             
@@ -140,13 +252,33 @@ int main(int argc, char* argv[]) {
         }
 
         // Execute CHIP-8 cycle
-        if (deltaTime >= targetFrameTime) {
-            chip8.cycle();
+        if (deltaTime >= targetFrameTime && (!paused || stepOnce)) {
+            stepOnce = false;
+            Chip8::RunResult result = chip8.run(debugger, 1, Chip8::StopOnUnknownOpcode);
             lastTime = currentTime;
 
+            if (result.reason == Chip8::StopReason::Breakpoint) {
+                paused = true;
+                printHit(debugger.lastHit());
+                printRegisters(chip8.getState());
+            } else if (result.reason == Chip8::StopReason::UnknownOpcode) {
+                // Skipped already, so resuming carries on after it
+                paused = true;
+                const Chip8Faults::Fault& fault = chip8.getFaults().last();
+                std::cout << std::hex << std::uppercase << "Unknown opcode 0x" << fault.opcode << " at 0x"
+                          << fault.address << std::dec << std::nouppercase << std::endl;
+                printRegisters(chip8.getState());
+            }
+
+            if (printTrace && result.cycles > 0) {
+                size_t newest = trace.size() - 1;
+                const Chip8Trace::Record* previous = newest > 0 ? &trace.at(newest - 1) : nullptr;
+                std::cout << Chip8Trace::format(trace.at(newest), previous) << std::endl;
+            }
+
             // Update display if draw flag is set
             if (chip8.drawFlag) {
-                printDisplay(chip8.display);
+                printDisplay(chip8.getDisplay());
                 std::cout << "Current delay: " << currentDelay << "ms" << std::endl;
                 chip8.drawFlag = false;
             }
@@ -162,5 +294,13 @@ int main(int argc, char* argv[]) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
+    chip8.getFaults().writeSummary(stdout);
+    if (traceFile) {
+        if (trace.save(traceFile))
+            std::cout << "Saved the last " << trace.size() << " instructions to " << traceFile << std::endl;
+        else
+            std::cerr << "Error: Could not write trace " << traceFile << std::endl;
+    }
+
     return 0;
 }
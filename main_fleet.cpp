@@ -0,0 +1,370 @@
+// Headless fleet runner: runs many independent CHIP-8 machines across all
+// cores for batch evaluation and regression runs. Machine states live in a
+// Chip8Pool and every worker thread owns one Chip8 that it attaches to the
+// machine it is running. Machines are scheduled in slices of a few frames
+// through per-worker queues; idle workers steal from the others. By
+// default a machine that runs into an unknown opcode halts there and is
+// reported as failed.
+#include "Chip8.h"
+#include "Chip8Pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options {
+    std::vector<std::string> roms;
+    int instances = 0;              // Defaults to one per ROM
+    int frames = 600;               // Per instance
+    int instructionsPerFrame = 10;
+    int sliceFrames = 60;           // Frames run before a machine is requeued
+    int threads = 0;                // Defaults to the hardware concurrency
+    uint64_t seed = 1;              // Instance i is seeded with seed + i
+    std::string inputPattern;       // Input script per instance, %d = index
+    Chip8Faults::Policy onFault = Chip8Faults::Policy::Halt;
+    Chip8Quirks::Profile quirks = Chip8Quirks::Profile::Default;
+    bool quiet = false;
+};
+
+// One line of an input script: "<frame> <key 0-F> <down|up>"
+struct InputEvent {
+    int frame;
+    int key;
+    bool pressed;
+};
+
+struct Instance {
+    Chip8State* state;
+    size_t rom;
+    std::vector<InputEvent> script;
+    size_t nextEvent = 0;
+    int frame = 0;
+    uint64_t cycles = 0;            // Instructions executed
+    uint64_t skipped = 0;           // Busy-wait instructions fast-forwarded
+    double seconds = 0.0;           // Time spent running this machine
+    uint64_t faults = 0;            // Unknown opcodes executed
+    bool halted = false;            // Stopped on an unknown opcode
+};
+
+static std::vector<uint8_t> readRom(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return {};
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static bool readScript(const std::string& path, std::vector<InputEvent>& script) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        InputEvent event;
+        std::string state;
+        if (fields >> event.frame >> std::hex >> event.key >> state && event.key >= 0 && event.key < 16) {
+            event.pressed = (state == "down");
+            script.push_back(event);
+        }
+    }
+    return true;
+}
+
+static std::string scriptPath(const std::string& pattern, int index) {
+    std::string path = pattern;
+    size_t marker = path.find("%d");
+    if (marker != std::string::npos)
+        path.replace(marker, 2, std::to_string(index));
+    return path;
+}
+
+static uint64_t framebufferHash(const Chip8State& state) {
+    uint64_t hash = 1469598103934665603ull;
+    for (uint64_t row : state.gfx) {
+        hash ^= row;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Per-worker task queues. Owners push and pop at the back, thieves take
+// from the front of other workers' queues. A worker that finds them all
+// empty sleeps in wait() until a task is pushed or close() is called.
+class WorkStealingQueues {
+public:
+    explicit WorkStealingQueues(int workers) : queues(workers), queued(0), closed(false) {}
+
+    void push(int worker, uint32_t task) {
+        {
+            std::lock_guard<std::mutex> guard(queues[worker].lock);
+            queues[worker].tasks.push_back(task);
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        std::lock_guard<std::mutex> guard(idleLock);
+        idle.notify_one();
+    }
+
+    bool pop(int worker, uint32_t& task) {
+        Queue& queue = queues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            return false;
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(int thief, uint32_t& task) {
+        int count = static_cast<int>(queues.size());
+        for (int i = 1; i < count; ++i) {
+            Queue& queue = queues[(thief + i) % count];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Block until some queue may have a task. False once closed.
+    bool wait() {
+        std::unique_lock<std::mutex> lock(idleLock);
+        idle.wait(lock, [this] { return closed || queued.load(std::memory_order_acquire) > 0; });
+        return !closed;
+    }
+
+    // No task will be pushed again, wake every waiting worker
+    void close() {
+        std::lock_guard<std::mutex> guard(idleLock);
+        closed = true;
+        idle.notify_all();
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+    };
+    std::vector<Queue> queues;
+    std::atomic<int> queued;        // Tasks in all queues
+    std::mutex idleLock;
+    std::condition_variable idle;
+    bool closed;
+};
+
+static void runSlice(Chip8& host, Instance& instance, const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+    host.attach(*instance.state);
+    uint64_t faults = host.getFaults().total();
+    uint64_t skipped = host.getSkippedCycles();
+
+    int end = std::min(instance.frame + options.sliceFrames, options.frames);
+    for (; instance.frame < end; ++instance.frame) {
+        while (instance.nextEvent < instance.script.size() &&
+               instance.script[instance.nextEvent].frame <= instance.frame) {
+            const InputEvent& event = instance.script[instance.nextEvent++];
+            host.setKey(event.key, event.pressed);
+        }
+        Chip8::RunResult result = host.runFrame(options.instructionsPerFrame);
+        instance.cycles += result.cycles;
+        if (result.reason == Chip8::StopReason::UnknownOpcode) {
+            // Fail fast: the machine is retired as it is
+            instance.halted = true;
+            instance.frame = options.frames;
+            break;
+        }
+    }
+
+    // Fast-forwarded busy waits are part of the run results but were never
+    // executed, so they are kept apart
+    skipped = host.getSkippedCycles() - skipped;
+    instance.cycles -= skipped;
+    instance.skipped += skipped;
+    instance.faults += host.getFaults().total() - faults;
+    instance.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <ROM file>...\n"
+              << "  -n <count>      Instances to run (default: one per ROM)\n"
+              << "  -f <frames>     Frames per instance (default: 600)\n"
+              << "  -i <count>      Instructions per frame (default: 10)\n"
+              << "  -t <threads>    Worker threads (default: all cores)\n"
+              << "  -s <seed>       Base random seed, instance i uses seed + i (default: 1)\n"
+              << "  --slice <n>     Frames per scheduling slice (default: 60)\n"
+              << "  --input <path>  Input script per instance, %d is replaced by the index\n"
+              << "  --on-fault <p>  Unknown opcodes: halt (default) or ignore\n"
+              << "  --quirks <p>    default, vip, chip48, schip or xochip \n"
+              << "  -q              Only print the totals\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-q")
+            options.quiet = true;
+        else if (arg == "-n" && hasValue)
+            options.instances = std::atoi(argv[++i]);
+        else if (arg == "-f" && hasValue)
+            options.frames = std::atoi(argv[++i]);
+        else if (arg == "-i" && hasValue)
+            options.instructionsPerFrame = std::atoi(argv[++i]);
+        else if (arg == "-t" && hasValue)
+            options.threads = std::atoi(argv[++i]);
+        else if (arg == "-s" && hasValue)
+            options.seed = std::strtoull(argv[++i], nullptr, 0);
+        else if (arg == "--slice" && hasValue)
+            options.sliceFrames = std::atoi(argv[++i]);
+        else if (arg == "--input" && hasValue)
+            options.inputPattern = argv[++i];
+        else if (arg == "--on-fault" && hasValue) {
+            if (!Chip8Faults::parsePolicy(argv[++i], options.onFault) ||
+                options.onFault == Chip8Faults::Policy::Trap)
+                return false;
+        } else if (arg == "--quirks" && hasValue) {
+            if (!Chip8Quirks::parse(argv[++i], options.quirks))
+                return false;
+        }
+        else if (!arg.empty() && arg[0] == '-')
+            return false;
+        else
+            options.roms.push_back(arg);
+    }
+
+    if (options.instances <= 0)
+        options.instances = static_cast<int>(options.roms.size());
+    if (options.threads <= 0)
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    return !options.roms.empty() && options.frames > 0 && options.instructionsPerFrame > 0 &&
+           options.sliceFrames > 0;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> roms;
+    for (const std::string& path : options.roms) {
+        roms.push_back(readRom(path));
+        if (roms.back().empty() || roms.back().size() > 4096 - 0x200) {
+            std::cerr << "Error: Could not load ROM file " << path << std::endl;
+            return 1;
+        }
+    }
+
+    // Set up every machine before any thread starts
+    Chip8Pool pool(options.instances);
+    std::vector<Instance> instances(options.instances);
+    for (int i = 0; i < options.instances; ++i) {
+        Instance& instance = instances[i];
+        instance.state = pool.acquire();
+        instance.rom = i % roms.size();
+        memcpy(instance.state->memory + 0x200, roms[instance.rom].data(), roms[instance.rom].size());
+        instance.state->rng.reseed(options.seed + i);
+        instance.state->cyclesPerTick = static_cast<uint32_t>(options.instructionsPerFrame);
+
+        if (!options.inputPattern.empty()) {
+            std::string path = scriptPath(options.inputPattern, i);
+            if (!readScript(path, instance.script))
+                std::cerr << "Warning: No input script " << path << " for instance " << i << std::endl;
+        }
+    }
+
+    // Tasks are instance indices
+    WorkStealingQueues queues(options.threads);
+    for (int i = 0; i < options.instances; ++i)
+        queues.push(i % options.threads, static_cast<uint32_t>(i));
+
+    std::atomic<int> remaining(options.instances);
+    auto worker = [&](int id) {
+        std::unique_ptr<Chip8> host(new Chip8(*instances[0].state));
+        // Faults are reported per instance below rather than logged
+        host->getFaults().setPolicy(options.onFault);
+        host->getFaults().setLogLimit(0);
+        host->setQuirks(options.quirks);
+        uint32_t task;
+        for (;;) {
+            if (!queues.pop(id, task) && !queues.steal(id, task)) {
+                // Machines still running elsewhere may be requeued
+                if (!queues.wait())
+                    break;
+                continue;
+            }
+            runSlice(*host, instances[task], options);
+            if (instances[task].frame < options.frames)
+                queues.push(id, task);
+            else if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                queues.close();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; ++i)
+        threads.emplace_back(worker, i);
+    for (std::thread& thread : threads)
+        thread.join();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t totalCycles = 0;
+    uint64_t totalSkipped = 0;
+    uint64_t totalFaults = 0;
+    int halted = 0;
+    for (int i = 0; i < options.instances; ++i) {
+        const Instance& instance = instances[i];
+        totalCycles += instance.cycles;
+        totalSkipped += instance.skipped;
+        totalFaults += instance.faults;
+        halted += instance.halted;
+        if (options.quiet)
+            continue;
+        double ips = instance.seconds > 0.0 ? instance.cycles / instance.seconds : 0.0;
+        printf("%5d  %-40.40s  %12llu instr  %12llu skipped  %10.2f MIPS  fb %016llx", i,
+               options.roms[instance.rom].c_str(), static_cast<unsigned long long>(instance.cycles),
+               static_cast<unsigned long long>(instance.skipped), ips / 1e6,
+               static_cast<unsigned long long>(framebufferHash(*instance.state)));
+        if (instance.halted) {
+            uint16_t pc = instance.state->pc & 0x0FFF;
+            printf("  HALTED on %02X%02X at %03X", instance.state->memory[pc],
+                   instance.state->memory[(pc + 1) & 0x0FFF], pc);
+        } else if (instance.faults) {
+            printf("  %llu unknown opcodes", static_cast<unsigned long long>(instance.faults));
+        }
+        printf("\n");
+    }
+
+    printf("%d instances, %d threads, %d frames each: %llu instructions executed in %.3f s, %.2f MIPS\n",
+           options.instances, options.threads, options.frames,
+           static_cast<unsigned long long>(totalCycles), wall, wall > 0.0 ? totalCycles / wall / 1e6 : 0.0);
+    printf("%llu busy-wait instructions fast-forwarded, not counted in MIPS\n",
+           static_cast<unsigned long long>(totalSkipped));
+    if (halted)
+        printf("%d of %d instances halted on an unknown opcode\n", halted, options.instances);
+    else if (totalFaults)
+        printf("%llu unknown opcodes skipped\n", static_cast<unsigned long long>(totalFaults));
+    return halted ? 2 : 0;
+}
@@ -0,0 +1,379 @@
+// Opcode microbenchmarks: every family of instructions the interpreter
+// implements gets a small synthetic ROM that runs it in a tight loop, so a
+// slowdown in one handler shows up on its own line instead of disappearing
+// into a game. Each loop body repeats the family's instructions, then jumps
+// back; the jump is counted and costs one instruction in every 65.
+#include "Chip8.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int bodyLength = 64;          // Instructions per loop iteration
+const uint16_t dataAddress = 0xE00; // Scratch memory well above the code
+
+// Minimal assembler for the generated ROMs
+class Program {
+public:
+    uint16_t here() const { return static_cast<uint16_t>(0x200 + bytes.size()); }
+    void op(uint16_t opcode) {
+        bytes.push_back(static_cast<uint8_t>(opcode >> 8));
+        bytes.push_back(static_cast<uint8_t>(opcode));
+    }
+    void data(uint8_t value) { bytes.push_back(value); }
+    void patch(uint16_t address, uint16_t opcode) {
+        bytes[address - 0x200] = static_cast<uint8_t>(opcode >> 8);
+        bytes[address - 0x200 + 1] = static_cast<uint8_t>(opcode);
+    }
+    const std::vector<uint8_t>& image() const { return bytes; }
+
+private:
+    std::vector<uint8_t> bytes;
+};
+
+// Give V0-VE distinct nonzero values
+void setRegisters(Program& p) {
+    for (int x = 0; x < 15; ++x)
+        p.op(static_cast<uint16_t>(0x6000 | x << 8 | (x * 37 + 11)));
+}
+
+// Loop `body` forever; it is called until it has emitted bodyLength
+// instructions, with the index of the next one
+template<typename Body>
+void loop(Program& p, Body body) {
+    uint16_t start = p.here();
+    for (int i = 0; i < bodyLength; )
+        i += body(p, i);
+    p.op(static_cast<uint16_t>(0x1000 | start));
+}
+
+uint16_t xy(int x, int y) {
+    return static_cast<uint16_t>((x & 0xF) << 8 | (y & 0xF) << 4);
+}
+
+std::vector<uint8_t> buildAlu() {
+    static const uint8_t ops[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+    Program p;
+    setRegisters(p);
+    loop(p, [](Program& p, int i) {
+        p.op(static_cast<uint16_t>(0x8000 | xy(i % 15, (i + 7) % 15) | ops[i % 9]));
+        return 1;
+    });
+    return p.image();
+}
+
+std::vector<uint8_t> buildLoad() {
+    Program p;
+    loop(p, [](Program& p, int i) {
+        switch (i % 3) {
+        case 0:  p.op(static_cast<uint16_t>(0x6000 | (i % 15) << 8 | i)); break;
+        case 1:  p.op(static_cast<uint16_t>(0x7000 | (i % 15) << 8 | 3)); break;
+        default: p.op(static_cast<uint16_t>(0xA000 | dataAddress | i)); break;
+        }
+        return 1;
+    });
+    return p.image();
+}
+
+// Conditional skips, half taken. A taken skip jumps over a 6XNN, which is
+// not executed; an untaken one runs it.
+std::vector<uint8_t> buildSkip() {
+    Program p;
+    setRegisters(p);
+    p.op(0x6E00);       // VE = 0
+    p.op(0x6D00);       // VD = 0
+    loop(p, [](Program& p, int i) {
+        switch (i / 2 % 8) {
+        case 0:  p.op(0x3E00); break;   // 3XNN taken
+        case 1:  p.op(0x3E01); break;   // 3XNN not taken
+        case 2:  p.op(0x4E01); break;   // 4XNN taken
+        case 3:  p.op(0x4E00); break;   // 4XNN not taken
+        case 4:  p.op(0x5ED0); break;   // 5XY0 taken
+        case 5:  p.op(0x5E10); break;   // 5XY0 not taken
+        case 6:  p.op(0x9E10); break;   // 9XY0 taken
+        default: p.op(0x9ED0); break;   // 9XY0 not taken
+        }
+        p.op(0x6F00);
+        return 2;
+    });
+    return p.image();
+}
+
+// EX9E / EXA1 with no key down, half taken
+std::vector<uint8_t> buildKeys() {
+    Program p;
+    p.op(0x6005);
+    loop(p, [](Program& p, int i) {
+        p.op(i / 2 % 2 ? 0xE09E : 0xE0A1);
+        p.op(0x6F00);
+        return 2;
+    });
+    return p.image();
+}
+
+// 2NNN / 00EE pairs into an empty subroutine placed after the loop
+std::vector<uint8_t> buildCall() {
+    Program p;
+    std::vector<uint16_t> calls;
+    loop(p, [&calls](Program& p, int) {
+        calls.push_back(p.here());
+        p.op(0x2000);
+        return 2;
+    });
+    uint16_t subroutine = p.here();
+    p.op(0x00EE);
+    for (uint16_t address : calls)
+        p.patch(address, static_cast<uint16_t>(0x2000 | subroutine));
+    return p.image();
+}
+
+// 1NNN to the next instruction and BNNN with V0 = 0
+std::vector<uint8_t> buildJump() {
+    Program p;
+    p.op(0x6000);
+    loop(p, [](Program& p, int i) {
+        uint16_t next = static_cast<uint16_t>(p.here() + 2);
+        p.op(static_cast<uint16_t>((i % 2 ? 0xB000 : 0x1000) | next));
+        return 1;
+    });
+    return p.image();
+}
+
+// Worst case DXYN: 15-row sprites of solid pixels at (60, 25), wrapping
+// across both the right and the bottom edge
+std::vector<uint8_t> buildDraw() {
+    Program p;
+    uint16_t setIndex = p.here();
+    p.op(0xA000);
+    p.op(0x603C);       // V0 = 60
+    p.op(0x6119);       // V1 = 25
+    loop(p, [](Program& p, int) {
+        p.op(0xD01F);
+        return 1;
+    });
+    p.patch(setIndex, static_cast<uint16_t>(0xA000 | p.here()));
+    for (int i = 0; i < 15; ++i)
+        p.data(0xFF);
+    return p.image();
+}
+
+std::vector<uint8_t> buildClear() {
+    Program p;
+    loop(p, [](Program& p, int) {
+        p.op(0x00E0);
+        return 1;
+    });
+    return p.image();
+}
+
+std::vector<uint8_t> buildBcd() {
+    Program p;
+    setRegisters(p);
+    p.op(0xA000 | dataAddress);
+    loop(p, [](Program& p, int i) {
+        p.op(static_cast<uint16_t>(0xF033 | (i % 15) << 8));
+        return 1;
+    });
+    return p.image();
+}
+
+// FX55 / FX65 of all sixteen registers
+std::vector<uint8_t> buildStore() {
+    Program p;
+    setRegisters(p);
+    p.op(0xA000 | dataAddress);
+    loop(p, [](Program& p, int) {
+        p.op(0xFF55);
+        return 1;
+    });
+    return p.image();
+}
+
+std::vector<uint8_t> buildRestore() {
+    Program p;
+    setRegisters(p);
+    p.op(0xA000 | dataAddress);
+    p.op(0xFF55);
+    loop(p, [](Program& p, int) {
+        p.op(0xFF65);
+        return 1;
+    });
+    return p.image();
+}
+
+std::vector<uint8_t> buildRandom() {
+    Program p;
+    loop(p, [](Program& p, int i) {
+        p.op(static_cast<uint16_t>(0xC000 | (i % 15) << 8 | 0xFF));
+        return 1;
+    });
+    return p.image();
+}
+
+// FX1E and FX29
+std::vector<uint8_t> buildIndex() {
+    Program p;
+    setRegisters(p);
+    loop(p, [](Program& p, int i) {
+        p.op(static_cast<uint16_t>((i % 2 ? 0xF029 : 0xF01E) | (i % 15) << 8));
+        return 1;
+    });
+    return p.image();
+}
+
+// FX15, FX07 and FX18
+std::vector<uint8_t> buildTimers() {
+    static const uint16_t ops[] = { 0xF015, 0xF007, 0xF018 };
+    Program p;
+    setRegisters(p);
+    loop(p, [](Program& p, int i) {
+        p.op(static_cast<uint16_t>(ops[i % 3] | (i % 15) << 8));
+        return 1;
+    });
+    return p.image();
+}
+
+struct Family {
+    const char* name;
+    const char* description;
+    std::vector<uint8_t> (*build)();
+};
+
+const Family families[] = {
+    { "alu",     "8XY0-8XYE arithmetic and logic",   buildAlu },
+    { "load",    "6XNN, 7XNN, ANNN",                 buildLoad },
+    { "skip",    "3XNN, 4XNN, 5XY0, 9XY0",           buildSkip },
+    { "keys",    "EX9E, EXA1",                       buildKeys },
+    { "call",    "2NNN, 00EE",                       buildCall },
+    { "jump",    "1NNN, BNNN",                       buildJump },
+    { "draw",    "DXYN, 15 rows, wrapped",           buildDraw },
+    { "clear",   "00E0",                             buildClear },
+    { "bcd",     "FX33",                             buildBcd },
+    { "store",   "FF55",                             buildStore },
+    { "restore", "FF65",                             buildRestore },
+    { "random",  "CXNN",                             buildRandom },
+    { "index",   "FX1E, FX29",                       buildIndex },
+    { "timers",  "FX15, FX07, FX18",                 buildTimers },
+};
+
+struct Options {
+    uint64_t cycles = 10000000;     // Per repetition
+    uint64_t warmup = 1000000;
+    int repetitions = 5;
+    bool json = false;
+    std::vector<std::string> only;  // Families to run, all if empty
+};
+
+struct Result {
+    const Family* family;
+    double best;                    // Nanoseconds per instruction
+    double median;
+};
+
+void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] [family...]\n"
+            "  -c <cycles>     Instructions per repetition (default: 10000000)\n"
+            "  -w <cycles>     Warm-up instructions (default: 1000000)\n"
+            "  -r <count>      Repetitions (default: 5)\n"
+            "  --json          Print the results as JSON\n"
+            "  --list          List the families\n",
+            program);
+}
+
+Result measure(const Family& family, const Options& options) {
+    std::vector<uint8_t> rom = family.build();
+    std::unique_ptr<Chip8> chip8(new Chip8());
+    chip8->loadRom(rom.data(), rom.size());
+    chip8->seedRandom(1);
+    chip8->runCycles(options.warmup);
+
+    std::vector<double> samples;
+    for (int i = 0; i < options.repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        chip8->runCycles(options.cycles);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        samples.push_back(seconds * 1e9 / options.cycles);
+    }
+    std::sort(samples.begin(), samples.end());
+    return { &family, samples.front(), samples[samples.size() / 2] };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--list") {
+            for (const Family& family : families)
+                printf("%-8s %s\n", family.name, family.description);
+            return 0;
+        } else if (arg == "-c" && hasValue) {
+            options.cycles = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "-w" && hasValue) {
+            options.warmup = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "-r" && hasValue) {
+            options.repetitions = std::atoi(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            options.only.push_back(arg);
+        }
+    }
+    if (options.cycles == 0 || options.repetitions <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& name : options.only) {
+        if (std::none_of(std::begin(families), std::end(families),
+                         [&name](const Family& family) { return name == family.name; })) {
+            fprintf(stderr, "Error: Unknown family %s, see --list\n", name.c_str());
+            return 1;
+        }
+    }
+    for (const Family& family : families) {
+        if (options.only.empty() ||
+            std::find(options.only.begin(), options.only.end(), family.name) != options.only.end())
+            results.push_back(measure(family, options));
+    }
+
+#ifdef CHIP8_SWITCH_DISPATCH
+    const char* dispatch = "switch";
+#else
+    const char* dispatch = "table";
+#endif
+
+    if (options.json) {
+        printf("{\n  \"dispatch\": \"%s\",\n  \"cycles\": %llu,\n  \"repetitions\": %d,\n  \"families\": [\n",
+               dispatch, static_cast<unsigned long long>(options.cycles), options.repetitions);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            printf("    { \"name\": \"%s\", \"ops\": \"%s\", \"ns_best\": %.3f, \"ns_median\": %.3f }%s\n",
+                   result.family->name, result.family->description, result.best, result.median,
+                   i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+        return 0;
+    }
+
+    printf("%s dispatch, %llu instructions x %d repetitions, ns per instruction\n", dispatch,
+           static_cast<unsigned long long>(options.cycles), options.repetitions);
+    printf("%-8s %8s %8s  %s\n", "family", "best", "median", "opcodes");
+    for (const Result& result : results)
+        printf("%-8s %8.2f %8.2f  %s\n", result.family->name, result.best, result.median,
+               result.family->description);
+    return 0;
+}
@@ -0,0 +1,343 @@
+// Ahead-of-time recompiler: translates a CHIP-8 ROM into a C++ source file
+// with one native function per basic block reachable from 0x200. The output
+// is compiled together with Chip8Aot.cpp (see the chip8_aot CMake target).
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const int ROM_START = 0x200;
+const int MAX_BLOCK_LENGTH = 64;
+
+enum class Op {
+    Unknown, CLS, RET, JP, CALL, SE_NN, SNE_NN, SE_VY, LD_NN, ADD_NN,
+    LD_VY, OR, AND, XOR, ADD_VY, SUB, SHR, SUBN, SHL, SNE_VY, LD_I, JP_V0,
+    RND, DRW, SKP, SKNP, LD_DT_READ, LD_KEY, LD_DT, LD_ST, ADD_I, LD_FONT,
+    BCD, STORE, LOAD
+};
+
+// Same patterns, in the same order, as the interpreter's dispatch table
+Op classify(uint16_t opcode) {
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if ((opcode & 0x000F) == 0x0) return Op::CLS;
+            if ((opcode & 0x000F) == 0xE) return Op::RET;
+            return Op::Unknown;
+        case 0x1000: return Op::JP;
+        case 0x2000: return Op::CALL;
+        case 0x3000: return Op::SE_NN;
+        case 0x4000: return Op::SNE_NN;
+        case 0x5000: return Op::SE_VY;
+        case 0x6000: return Op::LD_NN;
+        case 0x7000: return Op::ADD_NN;
+        case 0x8000:
+            switch (opcode & 0x000F) {
+                case 0x0: return Op::LD_VY;
+                case 0x1: return Op::OR;
+                case 0x2: return Op::AND;
+                case 0x3: return Op::XOR;
+                case 0x4: return Op::ADD_VY;
+                case 0x5: return Op::SUB;
+                case 0x6: return Op::SHR;
+                case 0x7: return Op::SUBN;
+                case 0xE: return Op::SHL;
+            }
+            return Op::Unknown;
+        case 0x9000: return Op::SNE_VY;
+        case 0xA000: return Op::LD_I;
+        case 0xB000: return Op::JP_V0;
+        case 0xC000: return Op::RND;
+        case 0xD000: return Op::DRW;
+        case 0xE000:
+            if ((opcode & 0x00FF) == 0x9E) return Op::SKP;
+            if ((opcode & 0x00FF) == 0xA1) return Op::SKNP;
+            return Op::Unknown;
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x07: return Op::LD_DT_READ;
+                case 0x0A: return Op::LD_KEY;
+                case 0x15: return Op::LD_DT;
+                case 0x18: return Op::LD_ST;
+                case 0x1E: return Op::ADD_I;
+                case 0x29: return Op::LD_FONT;
+                case 0x33: return Op::BCD;
+                case 0x55: return Op::STORE;
+                case 0x65: return Op::LOAD;
+            }
+            return Op::Unknown;
+    }
+    return Op::Unknown;
+}
+
+struct BasicBlock {
+    uint16_t address;
+    std::vector<uint16_t> opcodes;
+    bool setsPc;                // Last instruction leaves pc set
+};
+
+std::string hex(unsigned value, int digits) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "0x%0*X", digits, value);
+    return buffer;
+}
+
+class Recompiler {
+public:
+    explicit Recompiler(const std::vector<uint8_t>& rom) : rom(rom) {}
+
+    void analyse();
+    void emit(std::ostream& out, const std::string& romName) const;
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    const std::vector<uint8_t>& rom;
+    std::map<uint16_t, BasicBlock> blocks;
+
+    bool inRom(int address) const {
+        return address >= ROM_START && address + 1 < ROM_START + static_cast<int>(rom.size());
+    }
+    uint16_t fetch(int address) const {
+        return rom[address - ROM_START] << 8 | rom[address - ROM_START + 1];
+    }
+
+    void emitInstruction(std::ostream& out, uint16_t address, uint16_t opcode) const;
+};
+
+void Recompiler::analyse() {
+    std::vector<int> pending;
+    std::set<int> seen;
+    pending.push_back(ROM_START);
+
+    while (!pending.empty()) {
+        int start = pending.back();
+        pending.pop_back();
+        if ((start & 1) || !inRom(start) || !seen.insert(start).second)
+            continue;
+
+        BasicBlock block;
+        block.address = static_cast<uint16_t>(start);
+        block.setsPc = false;
+
+        int address = start;
+        while (inRom(address)) {
+            uint16_t opcode = fetch(address);
+            Op op = classify(opcode);
+
+            // Data and key waits are left to the interpreter
+            if (op == Op::Unknown)
+                break;
+            if (op == Op::LD_KEY) {
+                pending.push_back(address + 2);
+                break;
+            }
+
+            block.opcodes.push_back(opcode);
+            int next = address + 2;
+            address = next;
+
+            bool end = true;
+            switch (op) {
+                case Op::JP:
+                    pending.push_back(opcode & 0x0FFF);
+                    break;
+                case Op::CALL:
+                    pending.push_back(opcode & 0x0FFF);
+                    pending.push_back(next);
+                    break;
+                case Op::RET:
+                case Op::JP_V0:
+                    break;
+                case Op::SE_NN: case Op::SNE_NN: case Op::SE_VY: case Op::SNE_VY:
+                case Op::SKP: case Op::SKNP:
+                    pending.push_back(next);
+                    pending.push_back(next + 2);
+                    break;
+                case Op::DRW: case Op::BCD: case Op::STORE:
+                    pending.push_back(next);
+                    break;
+                default:
+                    end = false;
+            }
+            if (end) {
+                block.setsPc = true;
+                break;
+            }
+            if (static_cast<int>(block.opcodes.size()) == MAX_BLOCK_LENGTH) {
+                pending.push_back(next);
+                break;
+            }
+        }
+
+        if (!block.opcodes.empty())
+            blocks[block.address] = block;
+    }
+}
+
+void Recompiler::emitInstruction(std::ostream& out, uint16_t address, uint16_t opcode) const {
+    int x = (opcode & 0x0F00) >> 8;
+    int y = (opcode & 0x00F0) >> 4;
+    std::string vx = "V[" + hex(x, 1) + "]";
+    std::string vy = "V[" + hex(y, 1) + "]";
+    std::string nn = hex(opcode & 0x00FF, 2);
+    std::string nnn = hex(opcode & 0x0FFF, 3);
+    std::string skip = hex(address + 4, 3);
+    std::string next = hex(address + 2, 3);
+
+    // Instructions with side effects beyond registers run the interpreter handler
+    auto handler = [&](const char* name) {
+        out << "    {\n"
+            << "        const Chip8::Instruction in = { " << hex(opcode, 4) << ", " << nnn << ", "
+            << hex(x, 1) << ", " << hex(y, 1) << ", " << hex(opcode & 0x000F, 1) << ", " << nn << " };\n"
+            << "        s.pc = " << hex(address, 3) << ";\n"
+            << "        Chip8::" << name << "(c, in);\n"
+            << "    }\n";
+    };
+
+    out << "    // " << hex(address, 3) << ": " << hex(opcode, 4) << "\n";
+    switch (classify(opcode)) {
+        case Op::CLS:    handler("op00E0"); break;
+        case Op::RET:    out << "    --s.sp;\n    s.pc = s.stack[s.sp & 0xF] + 2;\n"; break;
+        case Op::JP:     out << "    s.pc = " << nnn << ";\n"; break;
+        case Op::CALL:   out << "    s.stack[s.sp & 0xF] = " << hex(address, 3) << ";\n    ++s.sp;\n    s.pc = " << nnn << ";\n"; break;
+        case Op::SE_NN:  out << "    s.pc = (" << vx << " == " << nn << ") ? " << skip << " : " << next << ";\n"; break;
+        case Op::SNE_NN: out << "    s.pc = (" << vx << " != " << nn << ") ? " << skip << " : " << next << ";\n"; break;
+        case Op::SE_VY:  out << "    s.pc = (" << vx << " == " << vy << ") ? " << skip << " : " << next << ";\n"; break;
+        case Op::SNE_VY: out << "    s.pc = (" << vx << " != " << vy << ") ? " << skip << " : " << next << ";\n"; break;
+        case Op::LD_NN:  out << "    " << vx << " = " << nn << ";\n"; break;
+        case Op::ADD_NN: out << "    " << vx << " += " << nn << ";\n"; break;
+        case Op::LD_VY:  out << "    " << vx << " = " << vy << ";\n"; break;
+        case Op::OR:     out << "    " << vx << " |= " << vy << ";\n"; break;
+        case Op::AND:    out << "    " << vx << " &= " << vy << ";\n"; break;
+        case Op::XOR:    out << "    " << vx << " ^= " << vy << ";\n"; break;
+        case Op::ADD_VY:
+            out << "    {\n        uint16_t sum = " << vx << " + " << vy << ";\n"
+                << "        V[0xF] = (sum > 255) ? 1 : 0;\n"
+                << "        " << vx << " = sum & 0xFF;\n    }\n";
+            break;
+        case Op::SUB:
+            out << "    V[0xF] = (" << vx << " > " << vy << ") ? 1 : 0;\n"
+                << "    " << vx << " -= " << vy << ";\n";
+            break;
+        case Op::SHR:
+            out << "    V[0xF] = " << vx << " & 0x1;\n    " << vx << " >>= 1;\n";
+            break;
+        case Op::SUBN:
+            out << "    V[0xF] = (" << vy << " > " << vx << ") ? 1 : 0;\n"
+                << "    " << vx << " = " << vy << " - " << vx << ";\n";
+            break;
+        case Op::SHL:
+            out << "    V[0xF] = " << vx << " >> 7;\n    " << vx << " <<= 1;\n";
+            break;
+        case Op::LD_I:   out << "    s.I = " << nnn << ";\n"; break;
+        case Op::JP_V0:  out << "    s.pc = " << nnn << " + V[0x0];\n"; break;
+        case Op::RND:    handler("opCXNN"); break;
+        case Op::DRW:    handler("opDXYN<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>"); break;
+        case Op::SKP:    out << "    s.pc = (s.key[" << vx << " & 0xF] != 0) ? " << skip << " : " << next << ";\n"; break;
+        case Op::SKNP:   out << "    s.pc = (s.key[" << vx << " & 0xF] == 0) ? " << skip << " : " << next << ";\n"; break;
+        case Op::LD_DT_READ: out << "    " << vx << " = c.delayTimer();\n"; break;
+        case Op::LD_DT:  out << "    c.setDelayTimer(" << vx << ");\n"; break;
+        case Op::LD_ST:  handler("opFX18"); break;
+        case Op::ADD_I:  out << "    s.I += " << vx << ";\n"; break;
+        case Op::LD_FONT: out << "    s.I = " << vx << " * 0x5;\n"; break;
+        case Op::BCD:    handler("opFX33"); break;
+        case Op::STORE:  handler("opFX55<Chip8Quirks::Set<Chip8Quirks::Profile::Default>>"); break;
+        case Op::LOAD:
+            for (int i = 0; i <= x; ++i)
+                out << "    V[" << hex(i, 1) << "] = s.memory[(s.I + " << i << ") & 0x0FFF];\n";
+            break;
+        case Op::Unknown:
+        case Op::LD_KEY:
+            break;
+    }
+    out << "    ++s.cycleCount;\n";
+}
+
+void Recompiler::emit(std::ostream& out, const std::string& romName) const {
+    out << "// Generated by chip8_recompile from " << romName << ". Do not edit.\n"
+        << "#include \"Chip8Aot.h\"\n\n";
+
+    // Every instruction is an entry point, and the block returns early
+    // when the budget runs out, so small budgets still run native code
+    for (const auto& entry : blocks) {
+        const BasicBlock& block = entry.second;
+        out << "template<> int Chip8Aot::block<" << hex(block.address, 3) << ">(Chip8& c, int first, int budget) {\n"
+            << "    Chip8State& s = *c.state;\n"
+            << "    uint8_t* V = s.V;\n"
+            << "    int n = 0;\n"
+            << "    switch (first) {\n";
+        uint16_t address = block.address;
+        for (size_t i = 0; i < block.opcodes.size(); ++i) {
+            out << "    case " << i << ":\n";
+            emitInstruction(out, address, block.opcodes[i]);
+            address += 2;
+            if (i + 1 < block.opcodes.size()) {
+                out << "    if (++n == budget) {\n        s.pc = " << hex(address, 3) << ";\n        return n;\n    }\n"
+                    << "    [[fallthrough]];\n";
+            } else {
+                out << "    ++n;\n";
+            }
+        }
+        out << "    }\n";
+        if (!block.setsPc)
+            out << "    s.pc = " << hex(address, 3) << ";\n";
+        out << "    (void)V;\n    (void)budget;\n    return n;\n}\n\n";
+    }
+
+    out << "const Chip8Aot::Block Chip8Aot::blocks[] = {\n";
+    for (const auto& entry : blocks) {
+        const BasicBlock& block = entry.second;
+        out << "    { " << hex(block.address, 3) << ", " << block.opcodes.size()
+            << ", &Chip8Aot::block<" << hex(block.address, 3) << "> },\n";
+    }
+    if (blocks.empty())
+        out << "    { 0, 0, nullptr },\n";
+    out << "};\n"
+        << "const int Chip8Aot::blockCount = " << blocks.size() << ";\n\n";
+
+    out << "const uint8_t Chip8Aot::romImage[] = {";
+    for (size_t i = 0; i < rom.size(); ++i)
+        out << (i % 16 == 0 ? "\n    " : " ") << hex(rom[i], 2) << ",";
+    if (rom.empty())
+        out << "\n    0x00,";
+    out << "\n};\n"
+        << "const int Chip8Aot::romSize = " << rom.size() << ";\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <ROM file> <output.cpp>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open ROM file " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (rom.size() > 4096 - ROM_START) {
+        std::cerr << "Error: ROM too large for memory" << std::endl;
+        return 1;
+    }
+
+    Recompiler recompiler(rom);
+    recompiler.analyse();
+
+    std::ostringstream source;
+    recompiler.emit(source, argv[1]);
+
+    std::ofstream output(argv[2]);
+    if (!output.is_open()) {
+        std::cerr << "Error: Could not write " << argv[2] << std::endl;
+        return 1;
+    }
+    output << source.str();
+
+    std::cout << "Recompiled " << argv[1] << ": " << recompiler.blockCount() << " blocks" << std::endl;
+    return 0;
+}
@@ -0,0 +1,41 @@
+// Headless movie player: replays a session recorded with --record as fast
+// as possible and checks that it ends in exactly the recorded state.
+#include "Chip8.h"
+#include "Chip8Movie.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <movie file> <ROM file>" << std::endl;
+        return 1;
+    }
+
+    Chip8Movie movie;
+    if (!movie.load(argv[1])) {
+        std::cerr << "Error: Could not read movie " << argv[1] << std::endl;
+        return 1;
+    }
+    if (Chip8Movie::hashFile(argv[2]) != movie.romHash) {
+        std::cerr << "Error: " << argv[2] << " is not the ROM the movie was recorded with" << std::endl;
+        return 1;
+    }
+
+    Chip8 chip8;
+    if (!chip8.loadRom(argv[2]))
+        return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t cycles = movie.play(chip8);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t stateHash = Chip8Movie::hashState(chip8);
+    bool match = stateHash == movie.endStateHash;
+    printf("%zu key events, %llu instructions in %.3f s, %.2f MIPS\n", movie.events.size(),
+           static_cast<unsigned long long>(cycles), seconds, seconds > 0.0 ? cycles / seconds / 1e6 : 0.0);
+    printf("Final state %016llx %s\n", static_cast<unsigned long long>(stateHash),
+           match ? "matches the recording" : "DIFFERS from the recording");
+    chip8.getFaults().writeSummary(stdout);
+    return match ? 0 : 2;
+}
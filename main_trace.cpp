@@ -0,0 +1,105 @@
+// Offline decoder for execution traces saved from a Chip8Trace: prints the
+// records as text, optionally filtered by address, instruction family,
+// changed register or cycle range.
+#include "Chip8.h"
+#include "Chip8Trace.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct Options {
+    const char* file = nullptr;
+    uint16_t pcFirst = 0;
+    uint16_t pcLast = 0x0FFF;
+    std::string family;             // e.g. "DXYN", empty for all
+    int reg = -1;                   // Only records that changed this V register
+    uint64_t from = 0;
+    uint64_t to = UINT64_MAX;
+    size_t last = 0;                // Only the last N matches, 0 for all
+};
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] <trace file>\n"
+            "  --pc <addr>[-<addr>]   Only instructions at these addresses (hex)\n"
+            "  --op <family>          Only this instruction family, e.g. DXYN or 8XY4\n"
+            "  --reg <n>              Only instructions that changed Vn (hex)\n"
+            "  --from <cycle>         Only from this instruction count on\n"
+            "  --to <cycle>           Only up to this instruction count\n"
+            "  --last <n>             Only the last n matching instructions\n",
+            program);
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--pc" && hasValue) {
+            std::string range = argv[++i];
+            size_t dash = range.find('-');
+            options.pcFirst = static_cast<uint16_t>(std::strtoul(range.substr(0, dash).c_str(), nullptr, 16));
+            options.pcLast = dash == std::string::npos
+                                 ? options.pcFirst
+                                 : static_cast<uint16_t>(std::strtoul(range.substr(dash + 1).c_str(), nullptr, 16));
+        } else if (arg == "--op" && hasValue) {
+            options.family = argv[++i];
+        } else if (arg == "--reg" && hasValue) {
+            options.reg = static_cast<int>(std::strtol(argv[++i], nullptr, 16));
+        } else if (arg == "--from" && hasValue) {
+            options.from = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--to" && hasValue) {
+            options.to = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--last" && hasValue) {
+            options.last = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 0));
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else if (!options.file) {
+            options.file = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return options.file && options.reg < 16;
+}
+
+static bool matches(const Chip8Trace::Record& record, const Options& options) {
+    uint16_t address = record.pc & 0x0FFF;
+    return address >= options.pcFirst && address <= options.pcLast &&
+           record.cycle >= options.from && record.cycle <= options.to &&
+           (options.reg < 0 || (record.changed & (1u << options.reg))) &&
+           (options.family.empty() || options.family == Chip8::opcodeFamilyName(Chip8::opcodeFamily(record.opcode)));
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Chip8Trace::Record> records;
+    uint64_t total = 0;
+    if (!Chip8Trace::load(options.file, records, &total)) {
+        fprintf(stderr, "Error: Could not read trace %s\n", options.file);
+        return 1;
+    }
+
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (matches(records[i], options))
+            selected.push_back(i);
+    }
+    size_t first = options.last && options.last < selected.size() ? selected.size() - options.last : 0;
+
+    printf("%llu instructions traced, %zu in the file, %zu shown\n", static_cast<unsigned long long>(total),
+           records.size(), selected.size() - first);
+    printf("%12s  %-3s  %-4s  %-7s changes\n", "cycle", "pc", "op", "family");
+    for (size_t i = first; i < selected.size(); ++i) {
+        size_t index = selected[i];
+        const Chip8Trace::Record* previous = index > 0 ? &records[index - 1] : nullptr;
+        printf("%s\n", Chip8Trace::format(records[index], previous).c_str());
+    }
+    return 0;
+}
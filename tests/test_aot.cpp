@@ -0,0 +1,71 @@
+// Differential test of Chip8Aot, linked with the ROM recompiled by
+// chip8_recompile: runs it through the recompiled code 1 to 8 instructions
+// per call and through Chip8::cycle(), and fails at the first call after
+// which the two machines differ. Blocks are entered mid-way and cut short
+// by the budget, so every call size must also run as many instructions as
+// recompiled code as a single unbounded call does.
+//
+// wrap_write.ch8 runs the block at 0x202, then overwrites it with FX55 from
+// I = 0x1202, which wraps to 0x202, and runs it again. A block left enabled
+// leaves V5 at 2 instead of 0x11.
+#include "Chip8.h"
+#include "Chip8Aot.h"
+#include "Chip8Movie.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <ROM file> [instructions]\n", argv[0]);
+        return 1;
+    }
+    int instructions = argc > 2 ? atoi(argv[2]) : 1000;
+
+    uint64_t expected;
+    {
+        Chip8 unbounded;
+        if (!unbounded.loadRom(argv[1]))
+            return 1;
+        Chip8Aot aot(unbounded);
+        aot.run(instructions);
+        expected = aot.getTranslatedCycles();
+    }
+    if (expected == 0) {
+        fprintf(stderr, "FAIL: no instruction ran as recompiled code\n");
+        return 1;
+    }
+
+    // Every call size, so each block is entered with room to run whole
+    for (int step = 1; step <= 8; ++step) {
+        Chip8 reference;
+        Chip8 translated;
+        if (!reference.loadRom(argv[1]) || !translated.loadRom(argv[1]))
+            return 1;
+        Chip8Aot aot(translated);
+
+        for (int i = 0; i < instructions; i += step) {
+            int count = std::min(step, instructions - i);
+            uint16_t pc = reference.getState().pc;
+            for (int j = 0; j < count; ++j)
+                reference.cycle();
+            aot.run(count);
+            if (Chip8Movie::hashState(reference) != Chip8Movie::hashState(translated)) {
+                fprintf(stderr, "FAIL: %d per call, states differ after instructions %d-%d (from pc 0x%03X), "
+                        "V5 %02X expected %02X\n", step, i + 1, i + step, pc, translated.getState().V[5],
+                        reference.getState().V[5]);
+                return 1;
+            }
+        }
+        if (aot.getTranslatedCycles() != expected) {
+            fprintf(stderr, "FAIL: %d per call, %llu instructions ran as recompiled code, expected %llu\n", step,
+                    static_cast<unsigned long long>(aot.getTranslatedCycles()),
+                    static_cast<unsigned long long>(expected));
+            return 1;
+        }
+    }
+
+    printf("OK: %d instructions at 1 to 8 per call, %llu recompiled\n", instructions,
+           static_cast<unsigned long long>(expected));
+    return 0;
+}
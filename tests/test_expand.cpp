@@ -0,0 +1,73 @@
+// Framebuffer expansion: the kernel Chip8Expand picked for this CPU is
+// checked against a per-pixel reference on edge patterns and random rows,
+// through expandRow() and through expand() at scales 1 to 4 with padded
+// lines. Padding between lines must be left alone.
+#include "Chip8Expand.h"
+#include "Chip8Random.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const uint32_t sentinel = 0xDEADBEEF;
+
+static uint32_t pixel(uint64_t bits, int x, uint32_t off, uint32_t on) {
+    return (bits >> (63 - x)) & 1 ? on : off;
+}
+
+int main() {
+    Chip8Random random;
+    random.reseed(10);
+
+    // Patterns that catch swapped lanes and bit order, then random rows
+    std::vector<uint64_t> rows = { 0, ~0ull, 0xAAAAAAAAAAAAAAAAull, 0x5555555555555555ull, 0x8000000000000001ull,
+                                   0x0123456789ABCDEFull };
+    for (int bit = 0; bit < 64; ++bit)
+        rows.push_back(1ull << bit);
+    while (rows.size() < 32 * 4)
+        rows.push_back(static_cast<uint64_t>(random.next()) << 32 | random.next());
+
+    const uint32_t palettes[][2] = { { 0xFF000000, 0xFFFFFFFF }, { 0x00000000, 0x80000001 }, { 0x12345678, 0x12345678 } };
+
+    for (const auto& palette : palettes) {
+        uint32_t off = palette[0];
+        uint32_t on = palette[1];
+
+        for (uint64_t bits : rows) {
+            uint32_t out[64];
+            Chip8Expand::expandRow(bits, off, on, out);
+            for (int x = 0; x < 64; ++x) {
+                if (out[x] != pixel(bits, x, off, on)) {
+                    fprintf(stderr, "FAIL: %s expandRow(%016llX): pixel %d is %08X\n", Chip8Expand::kernelName(),
+                            static_cast<unsigned long long>(bits), x, out[x]);
+                    return 1;
+                }
+            }
+        }
+
+        for (size_t first = 0; first < rows.size(); first += 32) {
+            for (int scale = 1; scale <= 4; ++scale) {
+                int width = 64 * scale;
+                int stride = width + 3;     // Padded lines
+                std::vector<uint32_t> dest(static_cast<size_t>(stride) * 32 * scale, sentinel);
+                Chip8Expand::expand(&rows[first], 32, off, on, dest.data(), stride * 4, scale);
+
+                for (int line = 0; line < 32 * scale; ++line) {
+                    uint64_t bits = rows[first + line / scale];
+                    for (int x = 0; x < stride; ++x) {
+                        uint32_t expected = x < width ? pixel(bits, x / scale, off, on) : sentinel;
+                        uint32_t actual = dest[static_cast<size_t>(line) * stride + x];
+                        if (actual != expected) {
+                            fprintf(stderr, "FAIL: %s expand() at scale %d: line %d, x %d is %08X, expected %08X\n",
+                                    Chip8Expand::kernelName(), scale, line, x, actual, expected);
+                            return 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("OK: %s kernel matched the reference on %zu rows at scales 1 to 4\n", Chip8Expand::kernelName(),
+           rows.size());
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Packed framebuffer: a generated ROM draws random sprites at random
+// positions, edges included, with the odd 00E0 in between. After every
+// instruction the packed rows, the 32-bit display and VF are checked
+// against a pixel by pixel model of DXYN, once with sprites wrapping at
+// the edges (the default profile) and once clipped (VIP). Every row the
+// model changed must also be reported by takeDirtyRows().
+#include "Chip8.h"
+#include "Chip8Random.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const int draws = 300;
+static const uint16_t spriteData = 0xE00;
+
+struct Model {
+    bool pixels[32][64];
+};
+
+static void draw(Model& model, const uint8_t* memory, unsigned vx, unsigned vy, uint16_t I, int n, bool clip,
+                 bool& collision, uint32_t& changed) {
+    collision = false;
+    for (int row = 0; row < n; ++row) {
+        uint8_t bits = memory[(I + row) & 0x0FFF];
+        for (int col = 0; col < 8; ++col) {
+            if (!(bits & (0x80 >> col)))
+                continue;
+            unsigned x = vx % 64 + col;
+            unsigned y = (clip ? vy % 32 : vy) + row;
+            if (clip && (x >= 64 || y >= 32))
+                continue;
+            x %= 64;
+            y %= 32;
+            collision |= model.pixels[y][x];
+            model.pixels[y][x] = !model.pixels[y][x];
+            changed |= 1u << y;
+        }
+    }
+}
+
+static std::vector<uint8_t> generate(Chip8Random& random) {
+    std::vector<uint8_t> rom;
+    auto emit = [&rom](uint16_t opcode) {
+        rom.push_back(static_cast<uint8_t>(opcode >> 8));
+        rom.push_back(static_cast<uint8_t>(opcode));
+    };
+    for (int i = 0; i < draws; ++i) {
+        if (random.next() % 40 == 0)
+            emit(0x00E0);
+        int x = random.next() % 15;
+        int y = (x + 1 + random.next() % 14) % 15;
+        emit(static_cast<uint16_t>(0x6000 | x << 8 | random.nextByte()));
+        emit(static_cast<uint16_t>(0x6000 | y << 8 | random.nextByte()));
+        emit(static_cast<uint16_t>(0xA000 | (spriteData + random.next() % 0xF0)));
+        emit(static_cast<uint16_t>(0xD000 | x << 8 | y << 4 | random.next() % 16));
+    }
+    emit(static_cast<uint16_t>(0x1000 | (0x200 + rom.size())));
+    rom.resize(spriteData + 0x100 - 0x200);
+    for (size_t i = spriteData - 0x200; i < rom.size(); ++i)
+        rom[i] = random.nextByte();
+    return rom;
+}
+
+static bool run(const std::vector<uint8_t>& rom, Chip8Quirks::Profile profile) {
+    Chip8 chip8;
+    if (!chip8.loadRom(rom.data(), rom.size()))
+        return false;
+    chip8.setQuirks(profile);
+    bool clip = profile != Chip8Quirks::Profile::Default;
+    const Chip8State& state = chip8.getState();
+
+    Model model;
+    memset(&model, 0, sizeof(model));
+    chip8.takeDirtyRows();
+
+    for (int i = 0; i < 5 * draws; ++i) {
+        uint16_t opcode = static_cast<uint16_t>(state.memory[state.pc] << 8 | state.memory[state.pc + 1]);
+        bool expectedCollision = false;
+        uint32_t changed = 0;
+        if (opcode == 0x00E0) {
+            for (int y = 0; y < 32; ++y) {
+                for (int x = 0; x < 64; ++x) {
+                    if (model.pixels[y][x])
+                        changed |= 1u << y;
+                    model.pixels[y][x] = false;
+                }
+            }
+        } else if ((opcode & 0xF000) == 0xD000) {
+            draw(model, state.memory, state.V[(opcode >> 8) & 0xF], state.V[(opcode >> 4) & 0xF], state.I,
+                 opcode & 0xF, clip, expectedCollision, changed);
+        }
+        chip8.cycle();
+
+        const uint32_t* display = chip8.getDisplay();
+        for (int y = 0; y < 32; ++y) {
+            for (int x = 0; x < 64; ++x) {
+                bool packed = (state.gfx[y] >> (63 - x)) & 1;
+                bool expanded = display[y * 64 + x] == 0xFFFFFFFF;
+                if (packed != model.pixels[y][x] || expanded != model.pixels[y][x]) {
+                    fprintf(stderr, "FAIL: %s: pixel %d,%d is %d (display %d) after %04X, expected %d\n",
+                            Chip8Quirks::name(profile), x, y, packed, expanded, opcode, model.pixels[y][x]);
+                    return false;
+                }
+            }
+        }
+        if ((opcode & 0xF000) == 0xD000 && state.V[0xF] != expectedCollision) {
+            fprintf(stderr, "FAIL: %s: VF %u after %04X, expected %d\n", Chip8Quirks::name(profile), state.V[0xF],
+                    opcode, expectedCollision);
+            return false;
+        }
+        uint32_t dirty = chip8.takeDirtyRows();
+        if ((changed & ~dirty) != 0) {
+            fprintf(stderr, "FAIL: %s: rows %08X changed by %04X, only %08X reported dirty\n",
+                    Chip8Quirks::name(profile), changed, opcode, dirty);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    Chip8Random random;
+    random.reseed(8);
+    std::vector<uint8_t> rom = generate(random);
+
+    if (!run(rom, Chip8Quirks::Profile::Default) || !run(rom, Chip8Quirks::Profile::VIP))
+        return 1;
+
+    printf("OK: %d random sprites drawn wrapped and clipped matched the pixel model\n", draws);
+    return 0;
+}
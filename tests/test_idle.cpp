@@ -0,0 +1,114 @@
+// Idle fast-forwarding: every program is run frame by frame through
+// Chip8::runFrame(), which skips delay timer polls, key waits and jumps to
+// self, and one instruction at a time through Chip8::cycle(), which skips
+// nothing. Keys are pressed and released on the same frames for both.
+// The machines must match after every frame, registers, timers, memory and
+// framebuffer included. On the built-in programs the fast one must have
+// skipped something; ROM files are only compared.
+#include "Chip8.h"
+#include "Chip8Movie.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const int instructionsPerFrame = 12;
+static const int frames = 600;
+
+// Delay timer poll between draws
+static const uint16_t pollProgram[] = {
+    0x6020,     // 200: V0 = 0x20
+    0xF015,     // 202: DT = V0
+    0xF007,     // 204: V0 = DT
+    0x3000,     // 206: skip if V0 == 0
+    0x1204,     // 208: jump 204
+    0x7101,     // 20A: V1 += 1
+    0xF129,     // 20C: I = digit V1
+    0xD235,     // 20E: draw at V2, V3
+    0x7204,     // 210: V2 += 4
+    0x1200,     // 212: jump 200
+};
+
+// Key wait, then the key is drawn
+static const uint16_t keyProgram[] = {
+    0xF10A,     // 200: V1 = key
+    0xF129,     // 202: I = digit V1
+    0xD235,     // 204: draw at V2, V3
+    0x7204,     // 206: V2 += 4
+    0x1200,     // 208: jump 200
+};
+
+// One draw, then a jump to self
+static const uint16_t haltProgram[] = {
+    0x6207,     // 200: V2 = 7
+    0xF229,     // 202: I = digit V2
+    0xD225,     // 204: draw at V2, V2
+    0x1206,     // 206: jump 206
+};
+
+static std::vector<uint8_t> image(const uint16_t* program, size_t count) {
+    std::vector<uint8_t> rom;
+    for (size_t i = 0; i < count; ++i) {
+        rom.push_back(static_cast<uint8_t>(program[i] >> 8));
+        rom.push_back(static_cast<uint8_t>(program[i]));
+    }
+    return rom;
+}
+
+static bool compare(const char* name, const std::vector<uint8_t>& rom, bool mustSkip) {
+    Chip8 fast;
+    Chip8 stepped;
+    if (!fast.loadRom(rom.data(), rom.size()) || !stepped.loadRom(rom.data(), rom.size()))
+        return false;
+    stepped.setCyclesPerTimerTick(instructionsPerFrame);
+
+    for (int frame = 0; frame < frames; ++frame) {
+        // Hold a different key for one frame in every seven
+        int key = (frame / 7) % 16;
+        bool pressed = frame % 7 == 3;
+        fast.setKey(key, pressed);
+        stepped.setKey(key, pressed);
+
+        fast.runFrame(instructionsPerFrame);
+        for (int i = 0; i < instructionsPerFrame; ++i)
+            stepped.cycle();
+
+        if (Chip8Movie::hashState(fast) != Chip8Movie::hashState(stepped)) {
+            fprintf(stderr, "FAIL: %s: states differ after frame %d (pc 0x%03X, expected 0x%03X)\n", name, frame,
+                    fast.getState().pc, stepped.getState().pc);
+            return false;
+        }
+    }
+
+    if (mustSkip && fast.getSkippedCycles() == 0) {
+        fprintf(stderr, "FAIL: %s: nothing was fast-forwarded\n", name);
+        return false;
+    }
+    printf("%s: %llu of %llu instructions fast-forwarded\n", name,
+           static_cast<unsigned long long>(fast.getSkippedCycles()),
+           static_cast<unsigned long long>(fast.getCycleCount()));
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (!compare("delay poll", image(pollProgram, sizeof(pollProgram) / sizeof(pollProgram[0])), true) ||
+        !compare("key wait", image(keyProgram, sizeof(keyProgram) / sizeof(keyProgram[0])), true) ||
+        !compare("jump to self", image(haltProgram, sizeof(haltProgram) / sizeof(haltProgram[0])), true))
+        return 1;
+
+    // ROM files named on the command line
+    for (int i = 1; i < argc; ++i) {
+        FILE* file = fopen(argv[i], "rb");
+        if (!file) {
+            fprintf(stderr, "FAIL: cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::vector<uint8_t> rom(4096 - 0x200);
+        rom.resize(fread(rom.data(), 1, rom.size(), file));
+        fclose(file);
+        if (!compare(argv[i], rom, false))
+            return 1;
+    }
+
+    printf("OK: runFrame() matched Chip8::cycle() over %d frames of %d programs\n", frames, 3 + (argc - 1));
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Movies: a session of a ROM is recorded with scripted key presses, some
+// of them in the middle of a frame, once under the CHIP48 quirks with a
+// fixed instruction rate and once under the VIP timing model. Each movie
+// must survive serialize(), save() and load() unchanged, and playing it on
+// a fresh machine, whatever that machine was seeded with, must end on the
+// recorded instruction count and state hash.
+#include "Chip8.h"
+#include "Chip8Movie.h"
+#include "Chip8Random.h"
+#include "Chip8Timing.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const int frames = 600;
+
+// Now and then a key changes, from a script that every recording repeats
+static void press(Chip8Movie& movie, Chip8& chip8, Chip8Random& script) {
+    uint32_t roll = script.next();
+    if (roll % 4 == 0)
+        movie.setKey(chip8, (roll >> 8) % 16, (roll >> 12) & 1);
+}
+
+static bool record(const char* rom, Chip8Timing::Model timing, Chip8Movie& movie) {
+    Chip8 chip8;
+    if (!chip8.loadRom(rom))
+        return false;
+    if (timing == Chip8Timing::Model::Instructions)
+        chip8.setQuirks(Chip8Quirks::Profile::CHIP48);
+    movie.begin(chip8, rom, 1234, 10, timing);
+
+    Chip8Random script;
+    script.reseed(17);
+    Chip8Timing model;
+    for (int frame = 0; frame < frames; ++frame) {
+        press(movie, chip8, script);
+        if (timing == Chip8Timing::Model::VIP) {
+            model.runFrame(chip8);
+            continue;
+        }
+        chip8.runCycles(3);
+        press(movie, chip8, script);
+        chip8.runFrame(10);
+    }
+    movie.end(chip8);
+    return true;
+}
+
+static bool check(const char* rom, const char* file, Chip8Timing::Model timing) {
+    const char* name = Chip8Timing::name(timing);
+    Chip8Movie movie;
+    if (!record(rom, timing, movie))
+        return false;
+    if (movie.events.empty() || movie.romHash != Chip8Movie::hashFile(rom)) {
+        fprintf(stderr, "FAIL: %s: %zu events, ROM hash %016llX\n", name, movie.events.size(),
+                static_cast<unsigned long long>(movie.romHash));
+        return false;
+    }
+
+    std::vector<uint8_t> bytes = movie.serialize();
+    Chip8Movie loaded;
+    if (!movie.save(file) || !loaded.load(file) || loaded.serialize() != bytes) {
+        fprintf(stderr, "FAIL: %s: movie did not survive save() and load()\n", name);
+        return false;
+    }
+    remove(file);
+
+    for (uint64_t seed = 0; seed < 2; ++seed) {
+        Chip8 chip8;
+        if (!chip8.loadRom(rom))
+            return false;
+        chip8.seedRandom(seed);
+        uint64_t played = loaded.play(chip8);
+        if (played != loaded.endCycle || Chip8Movie::hashState(chip8) != loaded.endStateHash) {
+            fprintf(stderr, "FAIL: %s: playback %llu ran %llu of %llu instructions, state %s\n", name,
+                    static_cast<unsigned long long>(seed), static_cast<unsigned long long>(played),
+                    static_cast<unsigned long long>(loaded.endCycle),
+                    Chip8Movie::hashState(chip8) == loaded.endStateHash ? "matches" : "differs");
+            return false;
+        }
+    }
+
+    // Cutting a movie short keeps only the earlier events
+    uint64_t cut = loaded.events[loaded.events.size() / 2].cycle;
+    loaded.truncate(cut);
+    if (loaded.events.empty() || loaded.events.back().cycle >= cut) {
+        fprintf(stderr, "FAIL: %s: truncate() kept events from %llu on\n", name, static_cast<unsigned long long>(cut));
+        return false;
+    }
+
+    printf("%s: %zu events over %llu instructions replayed\n", name, movie.events.size(),
+           static_cast<unsigned long long>(movie.endCycle));
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <ROM file> [scratch movie file]\n", argv[0]);
+        return 1;
+    }
+    const char* file = argc > 2 ? argv[2] : "chip8_test_movie.c8mv";
+
+    if (!check(argv[1], file, Chip8Timing::Model::Instructions) || !check(argv[1], file, Chip8Timing::Model::VIP))
+        return 1;
+
+    printf("OK: recordings replayed to the recorded state under both timing models\n");
+    return 0;
+}
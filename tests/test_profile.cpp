@@ -0,0 +1,130 @@
+// Execution profile: a ROM is stepped with a Chip8Profile attached while
+// the test counts every instruction itself from pc. The opcode, address
+// and family counts must match exactly. Under runFrame() the profile must
+// count what was executed and nothing that was fast-forwarded. The hot
+// spot listing must lead with the busiest address, and the CSV must have
+// one row per address executed.
+#include "Chip8.h"
+#include "Chip8Profile.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#ifndef CHIP8_PROFILE
+#error "The profile test needs the CHIP8_PROFILE hook"
+#endif
+
+static const int instructions = 20000;
+static const int frames = 600;
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <ROM file>\n", argv[0]);
+        return 1;
+    }
+
+    Chip8 chip8;
+    if (!chip8.loadRom(argv[1]))
+        return 1;
+    Chip8Profile profile(0);
+    chip8.setProfile(&profile);
+
+    std::map<uint16_t, uint64_t> opcodes;
+    std::map<uint16_t, uint64_t> addresses;
+    uint64_t families[Chip8::opcodeFamilyCount] = {};
+    for (int i = 0; i < instructions; ++i) {
+        const Chip8State& state = chip8.getState();
+        uint16_t address = state.pc & 0x0FFF;
+        uint16_t opcode = static_cast<uint16_t>(state.memory[address] << 8 | state.memory[(address + 1) & 0x0FFF]);
+        ++opcodes[opcode];
+        ++addresses[address];
+        ++families[Chip8::opcodeFamily(opcode)];
+        chip8.cycle();
+    }
+
+    if (profile.instructions() != static_cast<uint64_t>(instructions)) {
+        fprintf(stderr, "FAIL: %llu instructions profiled, expected %d\n",
+                static_cast<unsigned long long>(profile.instructions()), instructions);
+        return 1;
+    }
+    for (const auto& entry : opcodes) {
+        if (profile.opcodeCount(entry.first) != entry.second) {
+            fprintf(stderr, "FAIL: opcode %04X counted %llu times, expected %llu\n", entry.first,
+                    static_cast<unsigned long long>(profile.opcodeCount(entry.first)),
+                    static_cast<unsigned long long>(entry.second));
+            return 1;
+        }
+    }
+    uint16_t busiest = 0;
+    uint64_t busiestCount = 0;
+    for (const auto& entry : addresses) {
+        if (profile.addressCount(entry.first) != entry.second) {
+            fprintf(stderr, "FAIL: address %03X counted %llu times, expected %llu\n", entry.first,
+                    static_cast<unsigned long long>(profile.addressCount(entry.first)),
+                    static_cast<unsigned long long>(entry.second));
+            return 1;
+        }
+        if (entry.second > busiestCount) {
+            busiest = entry.first;
+            busiestCount = entry.second;
+        }
+    }
+    for (int family = 0; family < Chip8::opcodeFamilyCount; ++family) {
+        if (profile.familyCount(family) != families[family]) {
+            fprintf(stderr, "FAIL: family %s counted %llu times, expected %llu\n", Chip8::opcodeFamilyName(family),
+                    static_cast<unsigned long long>(profile.familyCount(family)),
+                    static_cast<unsigned long long>(families[family]));
+            return 1;
+        }
+    }
+
+    // Reports
+    FILE* report = tmpfile();
+    if (!report)
+        return 1;
+    profile.writeHotSpots(report, 5);
+    rewind(report);
+    char line[256];
+    char expected[16];
+    snprintf(expected, sizeof(expected), "0x%03X ", busiest);
+    if (!fgets(line, sizeof(line), report) || !fgets(line, sizeof(line), report) ||
+        strncmp(line, expected, strlen(expected)) != 0) {
+        fprintf(stderr, "FAIL: hot spots do not start with %03X\n", busiest);
+        return 1;
+    }
+    fclose(report);
+    report = tmpfile();
+    if (!report)
+        return 1;
+    profile.writeCsv(report);
+    rewind(report);
+    size_t addressRows = 0;
+    while (fgets(line, sizeof(line), report)) {
+        if (strncmp(line, "address,", 8) == 0)
+            ++addressRows;
+    }
+    fclose(report);
+    if (addressRows != addresses.size()) {
+        fprintf(stderr, "FAIL: %zu address rows in the CSV, expected %zu\n", addressRows, addresses.size());
+        return 1;
+    }
+
+    // Fast-forwarded waits are not executed, so not counted
+    profile.clear();
+    uint64_t start = chip8.getCycleCount();
+    uint64_t skipped = chip8.getSkippedCycles();
+    for (int frame = 0; frame < frames; ++frame)
+        chip8.runFrame(10);
+    uint64_t executed = chip8.getCycleCount() - start - (chip8.getSkippedCycles() - skipped);
+    if (profile.instructions() != executed) {
+        fprintf(stderr, "FAIL: %llu instructions profiled over %d frames, %llu executed\n",
+                static_cast<unsigned long long>(profile.instructions()), frames,
+                static_cast<unsigned long long>(executed));
+        return 1;
+    }
+
+    printf("OK: %d instructions over %zu addresses profiled exactly, hottest 0x%03X\n", instructions,
+           addresses.size(), busiest);
+    return 0;
+}
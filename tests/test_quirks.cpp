@@ -0,0 +1,96 @@
+// Quirk profiles: one small program per quirk runs under every profile on
+// the same machine. Each run first decodes the program under a different
+// profile and then restores the start state, so only Chip8::setQuirks()
+// tells the runs apart. Results are checked against the table in
+// Chip8Quirks.h, written out here rather than read from the Set policies.
+// Profile names must parse back to their profile.
+#include "Chip8.h"
+#include "Chip8Quirks.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using Profile = Chip8Quirks::Profile;
+
+struct Expected {
+    Profile profile;
+    uint64_t shifted;       // 8XY6 of VX = 5, VY = 3
+    uint64_t index;         // I after FX55 with I = 0x300, X = 1
+    uint64_t jump;          // B320 with V0 = 0x10, V3 = 0x08
+    uint64_t edgeRow;       // FF drawn at x = 60
+    uint64_t logicVF;       // VF after 8XY1 with VF = 5
+};
+
+static const Expected expectations[] = {
+    { Profile::Default,   2, 0x300, 0x330, 0xF00000000000000Full, 5 },
+    { Profile::VIP,       1, 0x302, 0x330, 0x000000000000000Full, 0 },
+    { Profile::CHIP48,    2, 0x301, 0x328, 0x000000000000000Full, 5 },
+    { Profile::SuperChip, 2, 0x300, 0x328, 0x000000000000000Full, 5 },
+    { Profile::XOChip,    1, 0x302, 0x330, 0xF00000000000000Full, 5 },
+};
+
+struct Program {
+    const char* name;
+    std::vector<uint16_t> code;
+    uint64_t Expected::*expected;
+    uint64_t (*result)(const Chip8State& state);
+};
+
+static const Program programs[] = {
+    { "8XY6", { 0x6105, 0x6203, 0x8126 }, &Expected::shifted,
+      [](const Chip8State& s) -> uint64_t { return s.V[1]; } },
+    { "FX55", { 0xA300, 0x60AA, 0x61BB, 0xF155 }, &Expected::index,
+      [](const Chip8State& s) -> uint64_t { return s.memory[0x300] == 0xAA && s.memory[0x301] == 0xBB ? s.I : 0; } },
+    { "BNNN", { 0x6010, 0x6308, 0xB320 }, &Expected::jump,
+      [](const Chip8State& s) -> uint64_t { return s.pc; } },
+    { "DXYN", { 0x603C, 0x6100, 0xA208, 0xD011, 0xFF00 }, &Expected::edgeRow,
+      [](const Chip8State& s) -> uint64_t { return s.gfx[0]; } },
+    { "8XY1", { 0x6F05, 0x6103, 0x6205, 0x8121 }, &Expected::logicVF,
+      [](const Chip8State& s) -> uint64_t { return s.V[0xF]; } },
+};
+
+// Run the instructions of `program`, a trailing data word excluded, from
+// power-on
+static void run(Chip8& chip8, const Program& program, Profile profile) {
+    Chip8State start;
+    Chip8::resetState(start);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        start.memory[0x200 + 2 * i] = static_cast<uint8_t>(program.code[i] >> 8);
+        start.memory[0x201 + 2 * i] = static_cast<uint8_t>(program.code[i]);
+    }
+    uint64_t instructions = program.code.back() == 0xFF00 ? program.code.size() - 1 : program.code.size();
+
+    chip8.setQuirks(profile == Profile::Default ? Profile::VIP : Profile::Default);
+    chip8.restore(start);
+    chip8.runCycles(instructions);
+    chip8.setQuirks(profile);
+    chip8.restore(start);
+    chip8.runCycles(instructions);
+}
+
+int main() {
+    Chip8 chip8;
+    for (const Expected& expected : expectations) {
+        const char* name = Chip8Quirks::name(expected.profile);
+        Profile parsed;
+        if (!Chip8Quirks::parse(name, parsed) || parsed != expected.profile) {
+            fprintf(stderr, "FAIL: profile name %s does not parse back\n", name);
+            return 1;
+        }
+
+        for (const Program& program : programs) {
+            run(chip8, program, expected.profile);
+            uint64_t actual = program.result(chip8.getState());
+            if (actual != expected.*program.expected) {
+                fprintf(stderr, "FAIL: %s under %s gave %llX, expected %llX\n", program.name, name,
+                        static_cast<unsigned long long>(actual),
+                        static_cast<unsigned long long>(expected.*program.expected));
+                return 1;
+            }
+        }
+    }
+
+    printf("OK: %zu quirks matched the table under %d profiles\n", sizeof(programs) / sizeof(programs[0]),
+           Chip8Quirks::profileCount);
+    return 0;
+}
@@ -0,0 +1,110 @@
+// CXNN randomness: a ROM draws random bytes in a loop. Every CXNN must take
+// one byte from the machine's Chip8Random and mask it; equal seeds must
+// give equal runs and different seeds different ones; a saved generator
+// state must replay the same bytes; an attached source must replace the
+// built-in generator. The bytes must also be roughly uniform.
+#include "Chip8.h"
+#include "Chip8Random.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const uint8_t program[] = {
+    0xC0, 0xFF,     // 200: V0 = random
+    0xC1, 0x0F,     // 202: V1 = random & 0x0F
+    0xC2, 0xA5,     // 204: V2 = random & 0xA5
+    0x12, 0x00,     // 206: jump 200
+};
+
+// The next `count` values CXNN leaves in its register
+static std::vector<uint8_t> draw(Chip8& chip8, int count) {
+    std::vector<uint8_t> values;
+    while (static_cast<int>(values.size()) < count) {
+        uint16_t pc = chip8.getState().pc;
+        chip8.cycle();
+        if (pc != 0x206)
+            values.push_back(chip8.getState().V[(pc - 0x200) / 2]);
+    }
+    return values;
+}
+
+class Counter : public Chip8RandomSource {
+public:
+    uint8_t nextByte() override { return next++; }
+    uint8_t next = 0;
+};
+
+int main() {
+    const uint8_t masks[] = { 0xFF, 0x0F, 0xA5 };
+    const int count = 3 * 1000;
+
+    // CXNN is the generator's next byte, masked
+    Chip8 chip8;
+    if (!chip8.loadRom(program, sizeof(program)))
+        return 1;
+    chip8.seedRandom(11);
+    Chip8Random reference;
+    reference.reseed(11);
+    std::vector<uint8_t> values = draw(chip8, count);
+    for (int i = 0; i < count; ++i) {
+        uint8_t expected = reference.nextByte() & masks[i % 3];
+        if (values[i] != expected) {
+            fprintf(stderr, "FAIL: draw %d is %02X, expected %02X\n", i, values[i], expected);
+            return 1;
+        }
+    }
+
+    // Same seed, same run; another seed, another run
+    Chip8 same;
+    Chip8 other;
+    if (!same.loadRom(program, sizeof(program)) || !other.loadRom(program, sizeof(program)))
+        return 1;
+    same.seedRandom(11);
+    other.seedRandom(12);
+    if (draw(same, count) != values) {
+        fprintf(stderr, "FAIL: equal seeds gave different draws\n");
+        return 1;
+    }
+    if (draw(other, count) == values) {
+        fprintf(stderr, "FAIL: seeds 11 and 12 gave the same draws\n");
+        return 1;
+    }
+
+    // A saved generator state replays the same bytes
+    Chip8Random::State saved = chip8.getRandomState();
+    std::vector<uint8_t> ahead = draw(chip8, count);
+    chip8.setRandomState(saved);
+    if (draw(chip8, count) != ahead) {
+        fprintf(stderr, "FAIL: restoring the generator state did not replay its draws\n");
+        return 1;
+    }
+
+    // An attached source replaces the generator
+    Counter counter;
+    chip8.setRandomSource(&counter);
+    std::vector<uint8_t> counted = draw(chip8, 3 * 300);
+    for (int i = 0; i < 3 * 300; ++i) {
+        uint8_t expected = static_cast<uint8_t>(i) & masks[i % 3];
+        if (counted[i] != expected) {
+            fprintf(stderr, "FAIL: draw %d from the attached source is %02X, expected %02X\n", i, counted[i],
+                    expected);
+            return 1;
+        }
+    }
+
+    // Every byte value within a generous band around the mean
+    Chip8Random uniform;
+    uniform.reseed(0);
+    int histogram[256] = {};
+    for (int i = 0; i < 256 * 256; ++i)
+        ++histogram[uniform.nextByte()];
+    for (int value = 0; value < 256; ++value) {
+        if (histogram[value] < 256 - 96 || histogram[value] > 256 + 96) {
+            fprintf(stderr, "FAIL: byte %02X drawn %d times in 65536\n", value, histogram[value]);
+            return 1;
+        }
+    }
+
+    printf("OK: CXNN followed the seeded generator, its saved state and an attached source\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Rewind: a ROM is run with scripted keys, each frame captured into a
+// Chip8Rewind and kept whole on the side. Every step back must give the
+// exact state of the frame before, and a machine restored to it must run
+// on exactly as it did the first time. With a small budget the oldest
+// frames are dropped, the budget is kept, and the frames that are left
+// still rewind exactly.
+#include "Chip8.h"
+#include "Chip8Movie.h"
+#include "Chip8Rewind.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const int instructionsPerFrame = 10;
+static const int frames = 3000;
+static const int steps = 200;
+static const size_t smallBudget = 64 * 1024;  // The smallest ring Chip8Rewind allocates
+
+static void runFrame(Chip8& chip8, int frame) {
+    chip8.setKey((frame / 5) % 16, frame % 5 < 2);
+    chip8.runFrame(instructionsPerFrame);
+}
+
+// Step back until the history runs out, checking each state against the
+// captures it should give. Returns the steps taken, -1 on a mismatch.
+static int rewindAll(Chip8Rewind& rewind, const std::vector<Chip8State>& history, int limit) {
+    Chip8State state;
+    int step = 0;
+    while (step < limit && rewind.rewind(state)) {
+        ++step;
+        const Chip8State& expected = history[history.size() - 1 - step];
+        if (memcmp(&state, &expected, sizeof(state)) != 0) {
+            fprintf(stderr, "FAIL: step %d back did not give frame %zu\n", step, history.size() - 1 - step);
+            return -1;
+        }
+    }
+    return step;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <ROM file>\n", argv[0]);
+        return 1;
+    }
+
+    Chip8 chip8;
+    if (!chip8.loadRom(argv[1]))
+        return 1;
+    Chip8Rewind rewind;
+    Chip8Rewind small(smallBudget);
+    std::vector<Chip8State> history(frames);
+    std::vector<uint64_t> hashes;
+    for (int frame = 0; frame < frames; ++frame) {
+        runFrame(chip8, frame);
+        chip8.snapshot(history[frame]);
+        hashes.push_back(Chip8Movie::hashState(chip8));
+        rewind.capture(history[frame]);
+        small.capture(history[frame]);
+    }
+
+    if (rewind.frames() != frames - 1) {
+        fprintf(stderr, "FAIL: %zu frames to rewind, expected %d\n", rewind.frames(), frames - 1);
+        return 1;
+    }
+    if (rewindAll(rewind, history, steps) != steps)
+        return 1;
+
+    // Resume from the frame rewound to
+    const int resume = frames - 1 - steps;
+    chip8.restore(history[resume]);
+    for (int frame = resume + 1; frame < frames; ++frame) {
+        runFrame(chip8, frame);
+        if (Chip8Movie::hashState(chip8) != hashes[frame]) {
+            fprintf(stderr, "FAIL: run resumed after frame %d differs at frame %d\n", resume, frame);
+            return 1;
+        }
+    }
+
+    // The small history drops its oldest frames to stay in budget
+    size_t kept = small.frames();
+    if (small.bytesUsed() > smallBudget || kept == 0 || kept >= static_cast<size_t>(frames - 1)) {
+        fprintf(stderr, "FAIL: %zu frames in %zu bytes with a %zu byte budget\n", kept, small.bytesUsed(),
+                smallBudget);
+        return 1;
+    }
+    int back = rewindAll(small, history, frames);
+    if (back != static_cast<int>(kept) || small.frames() != 0) {
+        fprintf(stderr, "FAIL: stepped back %d of %zu frames\n", back, kept);
+        return 1;
+    }
+
+    printf("OK: %d frames rewound and resumed exactly, %zu kept in %zu bytes\n", steps, kept, smallBudget);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Save states: a ROM is run with scripted keys and saved part way, both
+// with saveState() and with snapshot(). Loading either into a fresh
+// machine, and back into the original after it has run on, must give the
+// saved state and then the same run as the original, frame for frame.
+// Saving a loaded state must give the same bytes. Truncated, corrupt and
+// newer saves must be refused without touching the machine.
+#include "Chip8.h"
+#include "Chip8Movie.h"
+#include "Chip8SaveState.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const int instructionsPerFrame = 10;
+static const int frames = 300;
+
+// Hash after each of `count` frames from `first` on, with scripted keys
+static std::vector<uint64_t> run(Chip8& chip8, int first, int count) {
+    std::vector<uint64_t> hashes;
+    for (int frame = first; frame < first + count; ++frame) {
+        chip8.setKey((frame / 5) % 16, frame % 5 < 2);
+        chip8.runFrame(instructionsPerFrame);
+        hashes.push_back(Chip8Movie::hashState(chip8));
+    }
+    return hashes;
+}
+
+static bool same(const char* what, const std::vector<uint64_t>& actual, const std::vector<uint64_t>& expected) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (actual[i] != expected[i]) {
+            fprintf(stderr, "FAIL: %s: states differ %zu frames after the save\n", what, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <ROM file>\n", argv[0]);
+        return 1;
+    }
+
+    Chip8 original;
+    if (!original.loadRom(argv[1]))
+        return 1;
+    run(original, 0, frames);
+    std::vector<uint8_t> save = original.saveState();
+    Chip8State snapshot;
+    original.snapshot(snapshot);
+    uint64_t savedHash = Chip8Movie::hashState(original);
+    std::vector<uint64_t> expected = run(original, frames, frames);
+
+    // Into a fresh machine
+    Chip8 loaded;
+    if (!loaded.loadState(save.data(), save.size())) {
+        fprintf(stderr, "FAIL: loadState() refused its own save\n");
+        return 1;
+    }
+    if (Chip8Movie::hashState(loaded) != savedHash) {
+        fprintf(stderr, "FAIL: loaded state differs from the saved one\n");
+        return 1;
+    }
+    if (loaded.saveState() != save) {
+        fprintf(stderr, "FAIL: saving a loaded state gave different bytes\n");
+        return 1;
+    }
+    if (!same("fresh machine", run(loaded, frames, frames), expected))
+        return 1;
+
+    // Back into the original, whose decoded code and display are now stale
+    if (!original.loadState(save.data(), save.size()) ||
+        !same("original machine", run(original, frames, frames), expected))
+        return 1;
+
+    Chip8 restored;
+    restored.restore(snapshot);
+    if (!same("snapshot", run(restored, frames, frames), expected))
+        return 1;
+
+    // Refused saves leave the machine alone
+    std::vector<std::vector<uint8_t>> bad;
+    bad.push_back(std::vector<uint8_t>());
+    bad.push_back(std::vector<uint8_t>(save.begin(), save.begin() + Chip8SaveState::headerSize));
+    bad.push_back(std::vector<uint8_t>(save.begin(), save.end() - 1));
+    bad.push_back(save);
+    bad.back()[0] ^= 0xFF;                                  // Magic
+    bad.push_back(save);
+    bad.back()[4] = Chip8SaveState::version + 1;            // Newer version
+    bad.push_back(save);
+    bad.back()[8] ^= 0x01;                                  // Payload size
+
+    uint64_t before = Chip8Movie::hashState(loaded);
+    for (size_t i = 0; i < bad.size(); ++i) {
+        if (loaded.loadState(bad[i].data(), bad[i].size()) || Chip8Movie::hashState(loaded) != before) {
+            fprintf(stderr, "FAIL: bad save %zu was loaded\n", i);
+            return 1;
+        }
+    }
+
+    printf("OK: %zu byte save and snapshot resumed %d frames identically, %zu bad saves refused\n", save.size(),
+           frames, bad.size());
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Lazy timers: a ROM sets the delay and sound timers once and then reads
+// the delay timer in a loop. Stepping it one instruction at a time, every
+// FX07 must read the value a 60 Hz countdown would have reached by then,
+// and the sound must stop on the tick the sound timer runs out. Changing
+// the timer rate part way must keep the current values.
+#include "Chip8.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const uint16_t program[] = {
+    0x6005,     // 200: V0 = 5
+    0xF015,     // 202: DT = V0
+    0x6103,     // 204: V1 = 3
+    0xF118,     // 206: ST = V1
+    0xF207,     // 208: V2 = DT
+    0x1208,     // 20A: jump 208
+};
+
+static bool load(Chip8& chip8) {
+    std::vector<uint8_t> rom;
+    for (uint16_t opcode : program) {
+        rom.push_back(static_cast<uint8_t>(opcode >> 8));
+        rom.push_back(static_cast<uint8_t>(opcode));
+    }
+    return chip8.loadRom(rom.data(), rom.size());
+}
+
+static uint8_t expectedTimer(uint8_t value, uint64_t setTick, uint64_t tick) {
+    return tick - setTick >= value ? 0 : static_cast<uint8_t>(value - (tick - setTick));
+}
+
+// Step to `until` instructions, checking every FX07 and the sound against
+// timers of `delay` and `sound` written on tick `setTick`
+static bool check(Chip8& chip8, uint64_t until, uint8_t delay, uint8_t sound, uint64_t setTick, uint32_t perTick) {
+    while (chip8.getCycleCount() < until) {
+        uint64_t cycle = chip8.getCycleCount();
+        bool poll = chip8.getState().pc == 0x208;
+        chip8.cycle();
+        if (poll && chip8.getState().V[2] != expectedTimer(delay, setTick, cycle / perTick)) {
+            fprintf(stderr, "FAIL: FX07 at instruction %llu read %u, expected %u\n",
+                    static_cast<unsigned long long>(cycle), chip8.getState().V[2],
+                    expectedTimer(delay, setTick, cycle / perTick));
+            return false;
+        }
+        bool playing = expectedTimer(sound, setTick, chip8.getCycleCount() / perTick) > 0;
+        if (chip8.getCycleCount() > 4 && chip8.shouldPlaySound() != playing) {
+            fprintf(stderr, "FAIL: sound %s after instruction %llu\n", playing ? "stopped early" : "still on",
+                    static_cast<unsigned long long>(chip8.getCycleCount()));
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    // Both timers are written on tick 0 at 10 instructions per tick
+    Chip8 chip8;
+    if (!load(chip8))
+        return 1;
+    if (!check(chip8, 100, 5, 3, 0, 10))
+        return 1;
+
+    // Same ROM, rate changed on tick 2 with 3 left on the delay timer and
+    // 1 on the sound timer: both count on from there at the new rate
+    Chip8 slowed;
+    if (!load(slowed))
+        return 1;
+    while (slowed.getCycleCount() < 25)
+        slowed.cycle();
+    slowed.setCyclesPerTimerTick(100);
+    if (!check(slowed, 500, 3, 1, 0, 100))
+        return 1;
+
+    printf("OK: delay and sound timers counted down lazily at 10 and 100 instructions per tick\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+// COSMAC VIP timing: small programs run frame by frame through
+// Chip8Timing::runFrame(), with the instructions per frame and machine
+// cycles worked out by hand from the cost table in Chip8Timing.cpp. A
+// frame holds as many instructions as fit in the interpreter's 2588
+// cycles, the last one may overrun, DXYN only runs first in a frame, the
+// delay timer drops by one per frame, and busy waits are executed rather
+// than fast-forwarded.
+#include "Chip8.h"
+#include "Chip8Timing.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const int frames = 10;
+
+struct Case {
+    const char* name;
+    std::vector<uint16_t> code;
+    // Instructions and machine cycles of the first frame, then of every
+    // frame after it
+    uint64_t firstInstructions;
+    uint64_t firstCycles;
+    uint64_t instructions;
+    uint64_t cycles;
+};
+
+static const Case cases[] = {
+    // 7XNN 50 and 1NNN 63: 22 rounds leave 102 cycles, so 7001 and an
+    // overrunning 1200 still run, 46 instructions in 2599 cycles
+    { "add loop", { 0x7001, 0x1200 }, 46, 2599, 46, 2599 },
+    // 6XNN 46 and ANNN 52, then DXYN waits. After that the aligned sprite
+    // costs 40 + 26 + 5 * 12 = 126 and the jump 63
+    { "aligned sprite", { 0x6000, 0xA000, 0xD005, 0x1204 }, 2, 98, 2, 189 },
+    // At x = 3 each row adds 8 + 4 * 3: 40 + 26 + 5 * 32 = 226
+    { "unaligned sprite", { 0x6003, 0xA000, 0xD005, 0x1204 }, 2, 98, 2, 289 },
+};
+
+static bool load(Chip8& chip8, const std::vector<uint16_t>& code) {
+    std::vector<uint8_t> rom;
+    for (uint16_t word : code) {
+        rom.push_back(static_cast<uint8_t>(word >> 8));
+        rom.push_back(static_cast<uint8_t>(word));
+    }
+    return chip8.loadRom(rom.data(), rom.size());
+}
+
+static bool check(const Case& test) {
+    Chip8 chip8;
+    if (!load(chip8, test.code))
+        return false;
+    Chip8Timing timing;
+    for (int frame = 0; frame < frames; ++frame) {
+        uint64_t cycles = timing.getMachineCycles();
+        Chip8::RunResult result = timing.runFrame(chip8);
+        uint64_t expectedInstructions = frame == 0 ? test.firstInstructions : test.instructions;
+        uint64_t expectedCycles = frame == 0 ? test.firstCycles : test.cycles;
+        if (result.cycles != expectedInstructions || timing.getMachineCycles() - cycles != expectedCycles) {
+            fprintf(stderr, "FAIL: %s: frame %d ran %llu instructions in %llu cycles, expected %llu in %llu\n",
+                    test.name, frame, static_cast<unsigned long long>(result.cycles),
+                    static_cast<unsigned long long>(timing.getMachineCycles() - cycles),
+                    static_cast<unsigned long long>(expectedInstructions),
+                    static_cast<unsigned long long>(expectedCycles));
+            return false;
+        }
+        // The instruction count moves on to the next timer tick
+        if (chip8.getCycleCount() != (frame + 1) * static_cast<uint64_t>(Chip8Timing::cyclesPerTick)) {
+            fprintf(stderr, "FAIL: %s: %llu instructions counted after frame %d\n", test.name,
+                    static_cast<unsigned long long>(chip8.getCycleCount()), frame);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    for (const Case& test : cases) {
+        if (!check(test))
+            return 1;
+    }
+
+    // A delay timer poll reads one less every frame and is never skipped
+    Chip8 chip8;
+    if (!load(chip8, { 0x6005, 0xF015, 0xF107, 0x3100, 0x1204, 0x120A }))
+        return 1;
+    Chip8Timing timing;
+    for (int frame = 0; frame < frames; ++frame) {
+        timing.runFrame(chip8);
+        int expected = frame < 5 ? 5 - frame : 0;
+        if (chip8.getState().V[1] != expected) {
+            fprintf(stderr, "FAIL: delay timer read %u in frame %d, expected %d\n", chip8.getState().V[1], frame,
+                    expected);
+            return 1;
+        }
+    }
+    if (chip8.getSkippedCycles() != 0) {
+        fprintf(stderr, "FAIL: %llu instructions fast-forwarded under VIP timing\n",
+                static_cast<unsigned long long>(chip8.getSkippedCycles()));
+        return 1;
+    }
+
+    printf("OK: %zu programs matched the VIP cost model over %d frames, timers ticked per frame\n",
+           sizeof(cases) / sizeof(cases[0]), frames);
+    return 0;
+}